@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+// 替换全局 operator new 统计堆分配次数，用于验证广播路径的分配数不随客户端数量增长
+// 替换函数单独放在 AllocationCounter.cpp 中，调用处看不到其实现，不会把 free() 内联到 operator new 的分配上
+uint64_t allocationCount();
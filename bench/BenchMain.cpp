@@ -0,0 +1,5 @@
+// 微基准测试入口，各个 *Bench.cpp 通过 BENCHMARK() 注册用例
+
+#include <benchmark/benchmark.h>
+
+BENCHMARK_MAIN();
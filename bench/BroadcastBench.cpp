@@ -0,0 +1,78 @@
+// 广播扇出微基准测试
+// 对比 "每个客户端各自拷贝一份帧" 与 "共享同一个引用计数帧" 两种方式，
+// 并统计每次广播的堆分配次数，验证后者不随客户端数量增长
+
+#include "AllocationCounter.h"
+#include "mod/Frame.h"
+#include "mod/SendQueue.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace mclistener_ws_server;
+
+const std::string kPayload = R"({"content":"hello from the benchmark","player_name":"Steve","type":"player_msg"})";
+
+// 旧实现: 每个客户端重新构造帧头并拷贝负载
+std::vector<unsigned char> encodePerClient(const std::string& message) {
+    std::vector<unsigned char> frame;
+    frame.push_back(0x81);
+    frame.push_back(static_cast<unsigned char>(message.size()));
+    frame.insert(frame.end(), message.begin(), message.end());
+    return frame;
+}
+
+void BM_BroadcastCopyPerClient(benchmark::State& state) {
+    const auto clients = static_cast<size_t>(state.range(0));
+    std::vector<std::vector<std::vector<unsigned char>>> queues(clients);
+    for (auto& queue : queues) {
+        queue.reserve(1);
+    }
+
+    uint64_t before = allocationCount();
+    for (auto _ : state) {
+        for (auto& queue : queues) {
+            queue.push_back(encodePerClient(kPayload));
+        }
+        for (auto& queue : queues) {
+            queue.clear();
+        }
+    }
+    state.counters["allocs_per_broadcast"] =
+        static_cast<double>(allocationCount() - before) / static_cast<double>(state.iterations());
+}
+
+void BM_BroadcastSharedFrame(benchmark::State& state) {
+    const auto clients = static_cast<size_t>(state.range(0));
+    std::vector<std::unique_ptr<SendQueue>> queues;
+    for (size_t i = 0; i < clients; ++i) {
+        queues.push_back(std::make_unique<SendQueue>(64, OverflowPolicy::DropOldest));
+    }
+    std::vector<FrameRef> drained;
+    drained.reserve(64);
+
+    uint64_t before = allocationCount();
+    for (auto _ : state) {
+        // 与 WebSocketServer::broadcast 相同: 构造一次，共享给所有队列
+        FrameRef frame = OutboundFrame::text(kPayload);
+        for (auto& queue : queues) {
+            queue->push(frame);
+        }
+        for (auto& queue : queues) {
+            queue->popAll(drained);
+            drained.clear();
+        }
+    }
+    state.counters["allocs_per_broadcast"] =
+        static_cast<double>(allocationCount() - before) / static_cast<double>(state.iterations());
+}
+
+BENCHMARK(BM_BroadcastCopyPerClient)->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_BroadcastSharedFrame)->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+
+} // namespace
@@ -0,0 +1,301 @@
+// 消息格式化微基准测试
+// 入站: 群消息字段提取 (单遍扫描 / nlohmann::json 完整解析)，groupMessageFormat 模板渲染；出站: 事件序列化为 JSON (以及可选的 MessagePack)，"both" 模式的聊天去重，
+// 限流令牌桶，遥测采样的增量编码。
+// 字段提取在计时前先与完整解析的结果比对一组样例；事件序列化在计时前先与 nlohmann::json 的 dump() 逐字节比对一组固定样例，不一致时该基准报错而不是输出数据
+
+#include "mod/ChatDeduplicator.h"
+#include "mod/EventDispatcher.h"
+#include "mod/InboundScanner.h"
+#include "mod/MessageTemplate.h"
+#include "mod/Telemetry.h"
+#include "mod/TokenBucket.h"
+
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace mclistener_ws_server;
+
+void BM_RenderGroupMessage(benchmark::State& state) {
+    const MessageTemplate tmpl = MessageTemplate::compile("§7[{timestamp}] §b[{group_name}] §e{nickname}§r: {message}");
+    const MessageTemplate::Values values{"123456", "测试群", "Alex", "hello from the benchmark", "12:34:56", "qq"};
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tmpl.render(values));
+    }
+}
+
+// 参考实现: 完整解析后按字段读取 (改为单遍扫描之前的做法)，字段顺序与 GroupMessageFields 相同
+std::array<std::string, 6> extractReference(const std::string& message) {
+    auto json = nlohmann::json::parse(message);
+    return {json.value("type", ""),     json.value("group_id", ""), json.value("group_name", ""),
+            json.value("nickname", "未知用户"), json.value("message", ""),  json.value("platform", "")};
+}
+
+const std::string GroupMessageSample =
+    R"({"type":"group_to_server","group_id":"123456","group_name":"测试群","nickname":"Alex",)"
+    R"("message":"hello from the benchmark","platform":"qq","message_id":1234567890,"time":1700000000})";
+
+// 样例比对: 扫描成功的输入必须与完整解析的结果相同，完整解析拒绝的输入必须退回完整解析；
+// 第二个值表示该输入是否应由扫描器直接处理 (常见输入不应退回完整解析)
+bool verifyScanner(std::string& error) {
+    const std::pair<std::string, bool> cases[] = {
+        {GroupMessageSample, true},
+        {R"({"type":"group_to_server"})", true},
+        {R"({})", true},
+        {" \t\r\n{ \"type\" : \"resume\" , \"last_seq\" : 42 }\n", true},
+        {R"({"type":"group_to_server","nickname":"","message":"tab\tq\"b\\s\/ é中😀 \u0000end"})", true},
+        {R"({"type":"group_to_server","group_name":"§6群 😀","message":"a\nb","extra":[1,-2.5,0,true,false,null,{"k":["v"]},[]],"o":{}})", true},
+        {R"({"message":"first","type":"other","group_id":"x\"y"})", true},
+        {R"({"type":"group_to_server","message":"x"} )", true},
+        // 以下交给完整解析
+        {R"({"type":"group_to_server","message":"a","message":"b"})", false},
+        {R"({"type":"group_to_server","group_id":123456})", false},
+        {R"({"type":null})", false},
+        {R"({"type":"group_to_server","n":1e3})", false},
+        {R"({"type":"group_to_server","n":1E+999})", false},
+        {"{\"type\":\"group_to_server\",\"n\":1" + std::string(400, '0') + "}", false},
+        {R"({"type":"group_to_server","message":"\ud83d"})", false},
+        {R"({"type":"group_to_server","message":"\ude00"})", false},
+        {R"({"type":"group_to_server","message":"\x"})", false},
+        {"{\"type\":\"group_to_server\",\"message\":\"\xc0\xaf\"}", false},
+        {"{\"type\":\"group_to_server\",\"message\":\"\xed\xa0\x80\"}", false},
+        {"{\"type\":\"group_to_server\",\"message\":\"a\nb\"}", false},
+        {"\xef\xbb\xbf{\"type\":\"group_to_server\"}", false},
+        {R"({"type":"group_to_server",})", false},
+        {R"({"type":"group_to_server"} x)", false},
+        {R"({"type":"group_to_server","n":01})", false},
+        {R"({"type":"group_to_server","n":-})", false},
+        {R"({"type":"group_to_server","n":1.})", false},
+        {R"({"type":"group_to_server","b":tru})", false},
+        {R"({"type":"group_to_server","a":[1,]})", false},
+        {R"({"type":"group_to_server")", false},
+        {R"(["group_to_server"])", false},
+        {"", false},
+        {std::string(40, '[') + std::string(40, ']'), false},
+        {"{\"type\":\"group_to_server\",\"deep\":" + std::string(40, '[') + std::string(40, ']') + "}", false},
+    };
+
+    InboundScanner scanner;
+    for (const auto& [message, fast] : cases) {
+        GroupMessageFields fields{.nickname = "未知用户"};
+        bool scanned = scanner.scan(message, fields);
+        if (scanned != fast) {
+            error = std::string(fast ? "fell back: " : "scanned: ") + message;
+            return false;
+        }
+        if (!scanned) {
+            continue;
+        }
+        std::array<std::string, 6> expected;
+        try {
+            expected = extractReference(message);
+        } catch (const nlohmann::json::exception&) {
+            error = "scanned input rejected by the parser: " + message;
+            return false;
+        }
+        const std::string_view actual[] = {fields.type,     fields.groupId, fields.groupName,
+                                           fields.nickname, fields.message, fields.platform};
+        for (size_t i = 0; i < expected.size(); ++i) {
+            if (actual[i] != expected[i]) {
+                error = "field mismatch in " + message + ": " + std::string(actual[i]) + " != " + expected[i];
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// 参数 0: 单遍扫描；1: 参考实现 (完整解析后读取字段)
+void BM_ExtractGroupMessage(benchmark::State& state) {
+    std::string error;
+    if (!verifyScanner(error)) {
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    const bool reference = state.range(0) == 1;
+    InboundScanner scanner;
+
+    for (auto _ : state) {
+        if (reference) {
+            benchmark::DoNotOptimize(extractReference(GroupMessageSample));
+        } else {
+            GroupMessageFields fields{.nickname = "未知用户"};
+            benchmark::DoNotOptimize(scanner.scan(GroupMessageSample, fields));
+            benchmark::DoNotOptimize(fields);
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * GroupMessageSample.size()));
+}
+
+// 参考实现: 构造 nlohmann::json 后 dump() (改为直接写出 JSON 之前的做法)
+std::string serializeReference(const OutboundEvent& event, uint64_t seq, uint32_t playerId, bool withName) {
+    nlohmann::json msg;
+    msg["type"] = EventTypeNames[static_cast<size_t>(event.type)];
+    if (withName) {
+        msg["player_name"] = event.playerName;
+    }
+    if (playerId != 0) {
+        msg["player_id"] = playerId;
+    }
+    if (event.type == EventType::PlayerChat) {
+        msg["content"] = event.content;
+        if (event.suppressed > 0) {
+            msg["suppressed"] = event.suppressed;
+        }
+    }
+    if (seq != 0) {
+        msg["seq"] = seq;
+    }
+    return msg.dump();
+}
+
+OutboundEvent makeEvent(EventType type, std::string player, std::string content = {}, uint32_t suppressed = 0) {
+    OutboundEvent event;
+    event.type = type;
+    event.playerName = std::move(player);
+    event.content = std::move(content);
+    event.suppressed = suppressed;
+    return event;
+}
+
+// 金样比对: 各事件类型，带 / 不带 seq、suppressed、player_id，需要转义的字符和多字节 UTF-8
+bool verifySerializer(std::string& error) {
+    std::string controls;
+    for (int c = 0; c < 0x20; ++c) {
+        controls.push_back(static_cast<char>(c));
+    }
+    std::vector<OutboundEvent> events = {
+        makeEvent(EventType::PlayerJoin, "Steve"),
+        makeEvent(EventType::PlayerLeave, "Alex_2"),
+        makeEvent(EventType::PlayerChat, "Steve", "hello from the benchmark"),
+        makeEvent(EventType::PlayerChat, "Steve", "", 3),
+        makeEvent(EventType::PlayerChat, "\"quoted\" \\ name", "tab\tnewline\n/slash\x7f" + controls, 12),
+        makeEvent(EventType::PlayerChat, "玩家", "§6§l你好，世界 😀 café"),
+        makeEvent(EventType::PlayerJoin, std::string("mixed \xe4\xb8\xad\"") + controls.substr(1, 3)),
+    };
+    for (const auto& event : events) {
+        for (uint64_t seq : {uint64_t{0}, uint64_t{1}, uint64_t{18446744073709551615ull}}) {
+            for (uint32_t playerId : {0u, 7u, 4294967295u}) {
+                for (bool announce : {false, true}) {
+                    auto message = EventDispatcher::serialize(event, false, seq, playerId, announce);
+                    std::string expected = serializeReference(event, seq, 0, true);
+                    if (message.json != expected) {
+                        error = "mismatch: " + message.json + " != " + expected;
+                        return false;
+                    }
+                    if (playerId != 0) {
+                        bool withName = event.type == EventType::PlayerJoin || announce;
+                        expected = serializeReference(event, seq, playerId, withName);
+                        if (message.compactJson != expected) {
+                            error = "compact mismatch: " + message.compactJson + " != " + expected;
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // 不合法的 UTF-8 与 dump() 一样抛出异常
+    for (const char* invalid : {"\xff", "\xc0\xaf", "\xed\xa0\x80", "\xf4\x90\x80\x80", "trailing \xe4\xb8"}) {
+        try {
+            EventDispatcher::serialize(makeEvent(EventType::PlayerChat, "Steve", invalid), false);
+            error = "invalid UTF-8 was serialized";
+            return false;
+        } catch (const nlohmann::json::type_error&) {
+        }
+    }
+    return true;
+}
+
+// 参数 0: 只生成 JSON；1: 同时生成 MessagePack；2: 参考实现 (nlohmann::json 的 dump())
+void BM_SerializeChatEvent(benchmark::State& state) {
+    std::string error;
+    if (!verifySerializer(error)) {
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    const OutboundEvent event = makeEvent(EventType::PlayerChat, "Steve", "hello from the benchmark");
+    const bool withMsgPack = state.range(0) == 1;
+    const bool reference = state.range(0) == 2;
+
+    for (auto _ : state) {
+        if (reference) {
+            benchmark::DoNotOptimize(serializeReference(event, 0, 0, true));
+        } else {
+            benchmark::DoNotOptimize(EventDispatcher::serialize(event, withMsgPack));
+        }
+    }
+}
+
+// 每条聊天先由 hook、再由事件监听器捕获，第二次命中去重表
+void BM_DeduplicateChat(benchmark::State& state) {
+    ChatDeduplicator deduplicator;
+    const std::string player = "Steve";
+    std::string message = "hello from the benchmark #0000000";
+    uint64_t seq = 0;
+
+    for (auto _ : state) {
+        std::snprintf(message.data() + message.size() - 7, 8, "%07llu", static_cast<unsigned long long>(seq % 10000000));
+        uint64_t tick = seq++ / 4;
+        benchmark::DoNotOptimize(deduplicator.isDuplicate(player, message, CaptureSource::PacketHook, tick));
+        benchmark::DoNotOptimize(deduplicator.isDuplicate(player, message, CaptureSource::Event, tick));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * 2);
+}
+
+// 多个线程争用同一个令牌桶 (速率足够低，绝大多数调用被拒绝)
+void BM_TokenBucketAcquire(benchmark::State& state) {
+    static TokenBucket bucket;
+    const RateLimit limit = RateLimit::perMinute(60, 5);
+    int64_t admitted = 0;
+
+    for (auto _ : state) {
+        admitted += bucket.tryAcquire(limit);
+    }
+    benchmark::DoNotOptimize(admitted);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// N 个玩家，每次采样约一半玩家移动，每 100 次采样一个关键帧
+void BM_EncodeTelemetry(benchmark::State& state) {
+    const size_t players = static_cast<size_t>(state.range(0));
+    TelemetryEncoder encoder(100);
+    TelemetrySnapshot snapshot;
+    for (size_t i = 0; i < players; ++i) {
+        snapshot.add("Player" + std::to_string(i), static_cast<float>(i) * 3.5f, 64.0f, -static_cast<float>(i), 0, 20);
+    }
+    std::string out;
+    uint64_t seq = 0;
+    size_t bytes = 0;
+
+    for (auto _ : state) {
+        snapshot.tick = ++seq;
+        for (size_t i = seq % 2; i < players; i += 2) {
+            snapshot.x[i] += 17;
+            snapshot.z[i] -= 9;
+        }
+        encoder.encode(snapshot, out);
+        bytes += out.size();
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.counters["bytes_per_sample"] = benchmark::Counter(static_cast<double>(bytes) / static_cast<double>(seq));
+}
+
+BENCHMARK(BM_ExtractGroupMessage)->ArgName("mode")->Arg(0)->Arg(1);
+BENCHMARK(BM_RenderGroupMessage);
+BENCHMARK(BM_SerializeChatEvent)->ArgName("mode")->Arg(0)->Arg(1)->Arg(2);
+BENCHMARK(BM_DeduplicateChat);
+BENCHMARK(BM_TokenBucketAcquire)->ThreadRange(1, 8);
+BENCHMARK(BM_EncodeTelemetry)->ArgName("players")->Arg(10)->Arg(100);
+
+} // namespace
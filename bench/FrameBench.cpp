@@ -0,0 +1,77 @@
+// 帧编解码微基准测试
+// sendFrame: 构造出站文本帧并经过发送队列 (与 WebSocketServer::broadcast 的单客户端路径相同)
+// receiveFrame: 解析一条客户端发来的带掩码文本帧 (包含解掩码)
+
+#include "mod/Frame.h"
+#include "mod/FrameParser.h"
+#include "mod/SendQueue.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace mclistener_ws_server;
+
+// 按客户端的方式编码一条带掩码的文本帧
+std::string encodeMaskedText(const std::string& payload) {
+    static const unsigned char mask[4] = {0x12, 0x34, 0x56, 0x78};
+
+    std::string frame;
+    frame.push_back(static_cast<char>(0x81));
+    if (payload.size() < 126) {
+        frame.push_back(static_cast<char>(0x80 | payload.size()));
+    } else if (payload.size() <= 0xFFFF) {
+        frame.push_back(static_cast<char>(0x80 | 126));
+        frame.push_back(static_cast<char>((payload.size() >> 8) & 0xFF));
+        frame.push_back(static_cast<char>(payload.size() & 0xFF));
+    } else {
+        frame.push_back(static_cast<char>(0x80 | 127));
+        for (int i = 7; i >= 0; --i) {
+            frame.push_back(static_cast<char>((static_cast<uint64_t>(payload.size()) >> (i * 8)) & 0xFF));
+        }
+    }
+    frame.append(reinterpret_cast<const char*>(mask), 4);
+    for (size_t i = 0; i < payload.size(); ++i) {
+        frame.push_back(static_cast<char>(payload[i] ^ mask[i % 4]));
+    }
+    return frame;
+}
+
+void BM_SendFrame(benchmark::State& state) {
+    const std::string payload(static_cast<size_t>(state.range(0)), 'x');
+    SendQueue queue(64, OverflowPolicy::DropOldest);
+    std::vector<FrameRef> drained;
+    drained.reserve(64);
+
+    for (auto _ : state) {
+        queue.push(OutboundFrame::text(payload));
+        queue.popAll(drained);
+        benchmark::DoNotOptimize(drained.data());
+        drained.clear();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+void BM_ReceiveFrame(benchmark::State& state) {
+    const std::string frame = encodeMaskedText(std::string(static_cast<size_t>(state.range(0)), 'x'));
+    FrameParser parser(16 * 1024 * 1024);
+
+    for (auto _ : state) {
+        size_t consumed = parser.feed(frame.data(), frame.size());
+        if (consumed != frame.size() || parser.status() != FrameParser::Status::Ready) {
+            state.SkipWithError("frame was not parsed");
+            break;
+        }
+        benchmark::DoNotOptimize(parser.payload().data());
+        parser.next();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+BENCHMARK(BM_SendFrame)->Arg(64)->Arg(1024)->Arg(64 * 1024);
+BENCHMARK(BM_ReceiveFrame)->Arg(64)->Arg(1024)->Arg(64 * 1024);
+
+} // namespace
@@ -0,0 +1,38 @@
+// 握手微基准测试: Sec-WebSocket-Accept 计算 (SHA-1 + Base64) 与请求头查找
+
+#include "mod/Handshake.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+namespace {
+
+using namespace mclistener_ws_server;
+
+const std::string kRequest = "GET / HTTP/1.1\r\n"
+                             "Host: 127.0.0.1:8080\r\n"
+                             "Upgrade: websocket\r\n"
+                             "Connection: Upgrade\r\n"
+                             "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                             "Sec-WebSocket-Version: 13\r\n"
+                             "Sec-WebSocket-Protocol: mclistener.v1.msgpack\r\n"
+                             "Sec-WebSocket-Extensions: permessage-deflate; client_max_window_bits\r\n"
+                             "\r\n";
+
+void BM_ComputeAcceptKey(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(computeAcceptKey("dGhlIHNhbXBsZSBub25jZQ=="));
+    }
+}
+
+void BM_GetHeaderValue(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(getHeaderValue(kRequest, "Sec-WebSocket-Key"));
+    }
+}
+
+BENCHMARK(BM_ComputeAcceptKey);
+BENCHMARK(BM_GetHeaderValue);
+
+} // namespace
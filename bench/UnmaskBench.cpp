@@ -0,0 +1,102 @@
+// 负载解掩码微基准测试
+// 对比逐字节异或 (旧实现) 与标量 64 位 / SSE2 / AVX2 实现的吞吐量。
+// 每个实现在计时前先与逐字节参考实现逐一比对所有起始对齐、掩码偏移和长度余数，
+// 结果不一致时该基准报错而不是输出数据
+
+#include "mod/Unmask.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace mclistener_ws_server;
+
+const unsigned char kMask[4] = {0x37, 0xfa, 0x21, 0x3d};
+
+// 旧实现: payload[i] ^= mask[i % 4]
+void unmaskBytewise(char* data, size_t length, const unsigned char mask[4], size_t maskOffset) {
+    for (size_t i = 0; i < length; ++i) {
+        data[i] ^= mask[(maskOffset + i) % 4];
+    }
+}
+
+// 与参考实现比对，覆盖 0-31 字节起始偏移、0-3 掩码偏移、原地和异地两种用法
+bool verifyKernel(UnmaskKernel kernel, std::string& error) {
+    std::vector<size_t> lengths;
+    for (size_t length = 0; length <= 160; ++length) {
+        lengths.push_back(length);
+    }
+    lengths.push_back(4093);
+    lengths.push_back(65536 + 37);
+
+    std::vector<char> input(65536 + 256);
+    for (size_t i = 0; i < input.size(); ++i) {
+        input[i] = static_cast<char>(i * 131 + 7);
+    }
+
+    std::vector<char> expected(input.size());
+    std::vector<char> actual(input.size());
+    for (size_t length : lengths) {
+        for (size_t align = 0; align < 32; ++align) {
+            for (size_t maskOffset = 0; maskOffset < 4; ++maskOffset) {
+                for (bool inPlace : {false, true}) {
+                    std::memcpy(expected.data() + align, input.data() + align, length);
+                    unmaskBytewise(expected.data() + align, length, kMask, maskOffset);
+
+                    char* dst = actual.data() + align;
+                    std::memcpy(dst, input.data() + align, length);
+                    unmaskPayloadWith(kernel, dst, inPlace ? dst : input.data() + align, length, kMask, maskOffset);
+
+                    if (std::memcmp(expected.data() + align, dst, length) != 0) {
+                        error = "mismatch at length " + std::to_string(length) + ", align " + std::to_string(align)
+                              + ", mask offset " + std::to_string(maskOffset) + (inPlace ? ", in place" : "");
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void BM_UnmaskBytewise(benchmark::State& state) {
+    std::vector<char> buffer(static_cast<size_t>(state.range(0)), 'x');
+    for (auto _ : state) {
+        unmaskBytewise(buffer.data(), buffer.size(), kMask, 0);
+        benchmark::DoNotOptimize(buffer.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_UnmaskBytewise)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+void BM_Unmask(benchmark::State& state, UnmaskKernel kernel) {
+    if (!isUnmaskKernelSupported(kernel)) {
+        state.SkipWithError("kernel not supported on this CPU");
+        return;
+    }
+    std::string error;
+    if (!verifyKernel(kernel, error)) {
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    std::vector<char> buffer(static_cast<size_t>(state.range(0)), 'x');
+    for (auto _ : state) {
+        // 与帧解析器相同，原地解掩码
+        unmaskPayloadWith(kernel, buffer.data(), buffer.data(), buffer.size(), kMask, 0);
+        benchmark::DoNotOptimize(buffer.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    state.SetLabel(kernel == selectedUnmaskKernel() ? "selected" : "");
+}
+BENCHMARK_CAPTURE(BM_Unmask, scalar, UnmaskKernel::Scalar)->RangeMultiplier(16)->Range(64, 1 << 20);
+BENCHMARK_CAPTURE(BM_Unmask, sse2, UnmaskKernel::Sse2)->RangeMultiplier(16)->Range(64, 1 << 20);
+BENCHMARK_CAPTURE(BM_Unmask, avx2, UnmaskKernel::Avx2)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+} // namespace
@@ -0,0 +1,79 @@
+#include "mod/AsyncLogSink.h"
+
+#include <algorithm>
+
+namespace mclistener_ws_server {
+
+AsyncLogSink::AsyncLogSink(size_t capacity, Writer writer)
+    : mQueue(std::max<size_t>(capacity, 2)), mWriter(std::move(writer)) {}
+
+AsyncLogSink::~AsyncLogSink() {
+    stop();
+}
+
+void AsyncLogSink::start() {
+    if (mRunning) {
+        return;
+    }
+    mRunning = true;
+    mWorker = std::thread(&AsyncLogSink::run, this);
+}
+
+void AsyncLogSink::stop() {
+    if (!mRunning) {
+        return;
+    }
+    mRunning = false;
+    mSignal.fetch_add(1);
+    mSignal.notify_one();
+
+    if (mWorker.joinable()) {
+        mWorker.join();
+    }
+}
+
+bool AsyncLogSink::post(LogLevel level, std::string text) {
+    if (!mQueue.tryPush(Record{level, std::move(text)})) {
+        ++mDropped;
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mSleeping.load() && mSleeping.exchange(false)) {
+        mSignal.fetch_add(1);
+        mSignal.notify_one();
+    }
+    return true;
+}
+
+void AsyncLogSink::run() {
+    Record record;
+    uint64_t reportedDropped = 0;
+    while (true) {
+        if (mQueue.tryPop(record)) {
+            mWriter(record.level, record.text);
+            continue;
+        }
+
+        // 队列清空后补报期间丢弃的条数
+        uint64_t dropped = mDropped.load();
+        if (dropped != reportedDropped) {
+            mWriter(LogLevel::Warn, std::to_string(dropped - reportedDropped) + " log lines dropped (async log queue full)");
+            reportedDropped = dropped;
+        }
+
+        // 停止前先输出完队列中剩余的日志
+        if (!mRunning) {
+            break;
+        }
+
+        uint32_t seen = mSignal.load();
+        mSleeping = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mQueue.empty() && mRunning) {
+            mSignal.wait(seen);
+        }
+        mSleeping = false;
+    }
+}
+
+} // namespace mclistener_ws_server
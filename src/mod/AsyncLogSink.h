@@ -0,0 +1,65 @@
+#pragma once
+
+#include "mod/Log.h"
+#include "mod/MpscQueue.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace mclistener_ws_server {
+
+/**
+ * 异步日志输出
+ * 事件处理函数中只把已格式化的文本推入有界无锁队列，
+ * 控制台和文件 I/O 由专用线程通过 writer 完成，游戏线程不会被日志输出阻塞
+ *
+ * 队列满时丢弃新日志并计数，不会反过来阻塞调用方
+ */
+class AsyncLogSink {
+public:
+    using Writer = std::function<void(LogLevel level, const std::string& text)>;
+
+    AsyncLogSink(size_t capacity, Writer writer);
+    ~AsyncLogSink();
+
+    // 禁止拷贝
+    AsyncLogSink(const AsyncLogSink&) = delete;
+    AsyncLogSink& operator=(const AsyncLogSink&) = delete;
+
+    // 启动输出线程
+    void start();
+
+    // 输出完已入队的日志后停止
+    void stop();
+
+    // 提交一条日志 (任意线程，无锁)，队列满时丢弃并返回 false
+    bool post(LogLevel level, std::string text);
+
+    // 因队列满被丢弃的日志数
+    uint64_t getDroppedCount() const { return mDropped; }
+
+private:
+    struct Record {
+        LogLevel level = LogLevel::Info;
+        std::string text;
+    };
+
+    // 输出线程函数
+    void run();
+
+    MpscQueue<Record> mQueue;
+    Writer mWriter;
+    std::thread mWorker;
+    std::atomic<bool> mRunning{false};
+
+    // 与 EventDispatcher 相同: 输出线程只在真正休眠时才需要被唤醒
+    std::atomic<bool> mSleeping{false};
+    std::atomic<uint32_t> mSignal{0};
+
+    std::atomic<uint64_t> mDropped{0};
+};
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,50 @@
+#include "mod/ChatDeduplicator.h"
+
+namespace mclistener_ws_server {
+
+uint64_t ChatDeduplicator::hashChat(std::string_view player, std::string_view message) {
+    // FNV-1a，玩家名和消息之间混入分隔字节，避免 ("ab", "c") 与 ("a", "bc") 相同
+    constexpr uint64_t Prime = 1099511628211ull;
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : player) {
+        hash = (hash ^ c) * Prime;
+    }
+    hash = (hash ^ 0xFF) * Prime;
+    for (unsigned char c : message) {
+        hash = (hash ^ c) * Prime;
+    }
+    return hash == 0 ? 1 : hash;
+}
+
+bool ChatDeduplicator::isDuplicate(std::string_view player, std::string_view message, CaptureSource source,
+                                   uint64_t tick) {
+    const uint64_t hash = hashChat(player, message);
+    const uint8_t bit = static_cast<uint8_t>(1u << static_cast<unsigned>(source));
+    const size_t home = static_cast<size_t>(hash) & (SlotCount - 1);
+
+    Entry* victim = nullptr;
+    for (size_t i = 0; i < MaxProbe; ++i) {
+        Entry& entry = mSlots[(home + i) & (SlotCount - 1)];
+        if (entry.hash == hash) {
+            if (!expired(entry, tick) && !(entry.sources & bit)) {
+                entry.sources |= bit;
+                return true;
+            }
+            // 同一来源再次捕获 (玩家重复发送) 或记录已过期: 当作新的聊天
+            entry.tick = tick;
+            entry.sources = bit;
+            return false;
+        }
+        // 优先使用空槽位，其次覆盖最旧的条目
+        if (!victim || (victim->hash != 0 && (entry.hash == 0 || entry.tick < victim->tick))) {
+            victim = &entry;
+        }
+    }
+
+    victim->hash = hash;
+    victim->tick = tick;
+    victim->sources = bit;
+    return false;
+}
+
+} // namespace mclistener_ws_server
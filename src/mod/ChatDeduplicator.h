@@ -0,0 +1,49 @@
+#pragma once
+
+#include "mod/OutboundEvent.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace mclistener_ws_server {
+
+/**
+ * chatCaptureMode 为 "both" 时的聊天去重表
+ * TextPacket hook 和 PlayerChatEvent 会各自捕获同一条聊天，
+ * 这里以 (玩家, 消息) 的 64 位哈希为键记录最近的聊天以及已由哪些来源捕获:
+ * 另一个来源在时间窗口内捕获到相同的聊天即为重复；同一来源再次捕获则是玩家重复发送，照常广播
+ *
+ * 固定大小的开放寻址表，线性探测有上限，不删除条目，过期或最旧的条目直接被覆盖；
+ * 查找不分配内存。只由 EventDispatcher 的工作线程访问，不加锁
+ */
+class ChatDeduplicator {
+public:
+    // 槽位数 (2 的幂) 和最大探测长度
+    static constexpr size_t SlotCount = 256;
+    static constexpr size_t MaxProbe  = 8;
+
+    explicit ChatDeduplicator(uint64_t windowTicks = 20) : mWindowTicks(windowTicks) {}
+
+    // 记录一次捕获，返回 true 表示另一个来源已在窗口内捕获过同一条聊天，应丢弃
+    bool isDuplicate(std::string_view player, std::string_view message, CaptureSource source, uint64_t tick);
+
+private:
+    struct Entry {
+        uint64_t hash    = 0; // 0 表示空槽位
+        uint64_t tick    = 0; // 最近一次捕获的 tick
+        uint8_t  sources = 0; // 已捕获该聊天的来源位掩码
+    };
+
+    static uint64_t hashChat(std::string_view player, std::string_view message);
+
+    bool expired(const Entry& entry, uint64_t tick) const {
+        return tick > entry.tick && tick - entry.tick > mWindowTicks;
+    }
+
+    uint64_t mWindowTicks;
+    std::array<Entry, SlotCount> mSlots{};
+};
+
+} // namespace mclistener_ws_server
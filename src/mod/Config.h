@@ -10,23 +10,108 @@ struct Config {
     // 日志级别: "silent", "fatal", "error", "warn", "info", "debug", "trace"
     std::string logLevel = "info";
     
+    // 异步日志: 玩家聊天、进出等事件的 info 日志由专用线程输出，事件处理函数中不做控制台 / 文件 I/O
+    bool enableAsyncLogging = false;
+    
     // WebSocket 服务器配置
     std::string host = "0.0.0.0";
     int port = 60201;
     
+    // 本机传输: 非空时额外在该路径监听 Unix 域 socket (相对路径相对于插件数据目录)
+    // 与 BDS 运行在同一台机器上的客户端可以跳过 TCP 和 WebSocket 握手 / 掩码，消息协议不变
+    std::string localSocketPath = "";
+    
+    // 每个客户端发送队列的最大帧数
+    int sendQueueCapacity = 256;
+    
+    // 发送队列满时的处理策略: "drop_oldest", "drop_newest", "disconnect"
+    // - drop_oldest: 丢弃最旧的未发送消息
+    // - drop_newest: 丢弃新消息
+    // - disconnect: 断开该客户端
+    std::string sendQueueOverflowPolicy = "drop_oldest";
+    
+    // 游戏线程到网络工作线程的事件队列容量 (向上取整为 2 的幂)，队列满时新事件被丢弃
+    int eventQueueCapacity = 4096;
+    
+    // 批量发送 (默认关闭，每条消息一个帧)
+    // 开启后，刷新间隔内的事件合并发送，达到 batchMaxEvents 条时立即发送
+    bool enableBatching = false;
+    int batchFlushIntervalMs = 50;
+    int batchMaxEvents = 32;
+    // 批量格式: "json_array" (合并为一个 JSON 数组消息), "frames" (仍为独立消息，但在同一次 TCP 写入中发送)
+    std::string batchFormat = "json_array";
+    
+    // permessage-deflate 压缩 (RFC 7692)，仅对在握手中请求了该扩展的客户端生效
+    // 广播消息每种压缩参数只压缩一次，压缩结果在客户端之间共享
+    bool enablePerMessageDeflate = false;
+    // 小于该字节数的消息不压缩
+    int deflateMinPayloadSize = 128;
+    // 要求客户端每条消息独立压缩，服务端无需为每个连接保留 32KB 解压窗口
+    bool deflateClientNoContextTakeover = true;
+    
+    // 允许客户端通过 Sec-WebSocket-Protocol 协商 mclistener.msgpack.v1 子协议
+    // 协商成功的客户端收发 MessagePack 编码的二进制帧，其他客户端仍使用 JSON 文本帧
+    bool enableMsgPackProtocol = true;
+    
+    // 心跳与超时 (毫秒，0 表示关闭)，由事件循环中的时间轮统一驱动
+    // 每隔 pingIntervalMs 向客户端发送 ping，pongTimeoutMs 内没有收到 pong 则断开
+    int pingIntervalMs = 30000;
+    int pongTimeoutMs = 10000;
+    // 超过该时间没有收到客户端任何数据 (包括 pong) 则断开，建议与 ping 一起使用
+    int idleTimeoutMs = 0;
+    // 建立 TCP 连接后必须在该时间内完成 WebSocket 握手
+    int handshakeTimeoutMs = 10000;
+    
+    // 慢消费者: 发送队列帧数或未写出的字节数持续超过阈值 slowConsumerTimeoutMs 后断开 (阈值为 0 表示不检查该项)
+    // 默认关闭 (slowConsumerTimeoutMs 为 0)，开启时建议 30000
+    int slowConsumerQueueThreshold = 192;
+    int slowConsumerMaxBytes = 4 * 1024 * 1024;
+    int slowConsumerTimeoutMs = 0;
+    
+    // 在 WebSocket 端口上响应 GET /metrics (Prometheus 文本格式) 和 GET /healthz
+    bool enableMetricsEndpoint = true;
+    // /metrics 默认只响应本机 (127.0.0.0/8 和本机传输) 的请求，其他地址返回 403；/healthz 不受限制
+    bool metricsAllowRemote = false;
+    
+    // 出站事件日志: 广播的事件带上递增的 "seq" 字段，并追加到数据目录下的内存映射日志中
+    // 客户端重连后发送 {"type": "resume", "last_seq": N} 即可重放之后的事件
+    bool enableEventJournal = false;
+    // 日志保留的总大小，超出后回收最旧的事件
+    int journalRetentionMB = 64;
+    
+    // 遥测: 每 telemetryIntervalTicks 个 tick 在游戏线程采样所有玩家的坐标、维度和生命值，
+    // 增量编码后发给订阅了 "telemetry" 的客户端，每 telemetryKeyframeInterval 次采样发送一次完整关键帧
+    bool enableTelemetry = false;
+    int telemetryIntervalTicks = 20;
+    int telemetryKeyframeInterval = 100;
+    
     // 功能开关
     bool enablePlayerJoinBroadcast = true;
     bool enablePlayerLeaveBroadcast = true;
     bool enablePlayerChatBroadcast = true;
     bool enableReceiveGroupMessage = true;
     
+    // 入站群消息先在网络线程解析并入队，再由游戏线程在每个 tick 中发给玩家
+    // 每个 tick 最多处理 inboundMaxMessagesPerTick 条、耗时 inboundMaxMicrosPerTick 微秒，其余留给之后的 tick
+    int inboundQueueCapacity = 1024;
+    int inboundMaxMessagesPerTick = 8;
+    int inboundMaxMicrosPerTick = 1000;
+    
     // 聊天捕获方式: "event", "hook_packet", "both"
     // - event: 使用 LeviLamina 的 PlayerChatEvent (可能被其他插件拦截)
     // - hook_packet: 直接 hook TextPacket 处理 (更可靠，但优先级较低)
-    // - both: 同时使用两种方式 (可能导致重复消息)
+    // - both: 同时使用两种方式，两边都捕获到的同一条聊天去重后只广播一次
     std::string chatCaptureMode = "event";
     
-    // 消息格式配置
+    // 限流 (令牌桶): 平均每分钟最多 N 条，允许短时间突发 Burst 条，速率为 0 表示不限制
+    // 玩家聊天超出后丢弃，丢弃的条数附在该玩家下一条广播的聊天的 "suppressed" 字段中
+    int playerChatRateLimit = 0;
+    int playerChatBurst = 5;
+    // 每个客户端连接发来的消息 (包括 resume / subscribe) 超出后丢弃，丢弃条数记录在日志和指标中
+    int clientMessageRateLimit = 0;
+    int clientMessageBurst = 10;
+    
+    // 消息格式配置，可用占位符: {group_id} {group_name} {nickname} {message} {timestamp} {platform}
     std::string groupMessageFormat = "§6§l[{group_name}]§r §b({group_id})§r §a§o{nickname}§r§f: {message}";
 };
 
@@ -0,0 +1,431 @@
+#include "mod/EventDispatcher.h"
+#include "mod/EventJournal.h"
+#include "mod/Handshake.h"
+#include "mod/JsonWriter.h"
+#include "mod/Subscription.h"
+#include "mod/WebSocketServer.h"
+
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cctype>
+
+namespace mclistener_ws_server {
+
+// 工作线程在进入等待前的自旋次数，突发事件期间避免频繁休眠 / 唤醒
+static constexpr int IDLE_SPIN_COUNT = 64;
+
+// 两种捕获方式得到同一条聊天的最大 tick 间隔 (通常在同一个 tick 内)
+static constexpr uint64_t CHAT_DEDUP_WINDOW_TICKS = 20;
+
+// 限流表超过该玩家数时清理已回满的令牌桶 (玩家离开时也会移除)
+static constexpr size_t MAX_RATE_LIMITED_PLAYERS = 1024;
+
+EventDispatcher::EventDispatcher(WebSocketServer& server, const Config& config, Logger& logger)
+    : mServer(server), mConfig(config), mLogger(logger),
+      mQueue(static_cast<size_t>(std::max(config.eventQueueCapacity, 2))),
+      mChatDeduplicator(CHAT_DEDUP_WINDOW_TICKS),
+      mTelemetryEncoder(static_cast<uint32_t>(std::max(config.telemetryKeyframeInterval, 1))) {
+    mBatching = config.enableBatching;
+    mBatchMaxEvents = static_cast<size_t>(std::max(config.batchMaxEvents, 1));
+    mBatchInterval = std::chrono::milliseconds(std::max(config.batchFlushIntervalMs, 1));
+
+    std::string format = config.batchFormat;
+    std::transform(format.begin(), format.end(), format.begin(),
+                   [](unsigned char c){ return std::tolower(c); });
+    mBatchAsArray = format != "frames";
+
+    std::string mode = config.chatCaptureMode;
+    std::transform(mode.begin(), mode.end(), mode.begin(),
+                   [](unsigned char c){ return std::tolower(c); });
+    mDeduplicateChat = mode == "both";
+
+    mChatRateLimit = RateLimit::perMinute(config.playerChatRateLimit, config.playerChatBurst);
+    mBatch.reserve(mBatchMaxEvents);
+    mBatchCapturedAt.reserve(mBatchMaxEvents);
+}
+
+EventDispatcher::~EventDispatcher() {
+    stop();
+}
+
+void EventDispatcher::start() {
+    if (mRunning) {
+        return;
+    }
+    mRunning = true;
+    mWorker = std::thread(&EventDispatcher::run, this);
+    mLogger.debug("Event dispatcher started (queue capacity: {})", mQueue.capacity());
+    if (mBatching) {
+        mLogger.debug("Batching enabled: flush every {} ms or {} events, format: {}",
+                      mBatchInterval.count(), mBatchMaxEvents, mBatchAsArray ? "json_array" : "frames");
+    }
+    if (mDeduplicateChat) {
+        mLogger.debug("Chat deduplication enabled (window: {} ticks)", CHAT_DEDUP_WINDOW_TICKS);
+    }
+    if (mChatRateLimit.enabled()) {
+        mLogger.debug("Player chat rate limit: {} per minute, burst {}", mConfig.playerChatRateLimit,
+                      mChatRateLimit.burst);
+    }
+}
+
+void EventDispatcher::stop() {
+    if (!mRunning) {
+        return;
+    }
+    mRunning = false;
+    mSignal.fetch_add(1);
+    mSignal.notify_one();
+
+    if (mWorker.joinable()) {
+        mWorker.join();
+    }
+    mLogger.debug("Event dispatcher stopped, {} events dropped in total", mDropped.load());
+}
+
+bool EventDispatcher::post(OutboundEvent&& event) {
+    if (!mQueue.tryPush(std::move(event))) {
+        ++mDropped;
+        mServer.getMetrics().eventsDropped.add();
+        return false;
+    }
+    // 只有工作线程真正休眠时才需要系统调用唤醒
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mSleeping.load() && mSleeping.exchange(false)) {
+        mSignal.fetch_add(1);
+        mSignal.notify_one();
+    }
+    return true;
+}
+
+void EventDispatcher::run() {
+    mLogger.debug("Event dispatcher worker started");
+
+    OutboundEvent event;
+    int idleSpins = 0;
+    while (true) {
+        if (mQueue.tryPop(event)) {
+            idleSpins = 0;
+            try {
+                dispatch(event);
+            } catch (const std::exception& e) {
+                mLogger.error("Failed to dispatch event: {}", e.what());
+            }
+            continue;
+        }
+
+        // 停止前先处理完队列中剩余的事件
+        if (!mRunning) {
+            break;
+        }
+
+        // 有未发出的批次时不能无限期休眠，按刷新时间点短暂等待
+        if (!mBatch.empty()) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= mBatchDeadline) {
+                flushBatch();
+            } else {
+                std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                    mBatchDeadline - now, std::chrono::milliseconds(1)));
+            }
+            idleSpins = 0;
+            continue;
+        }
+
+        if (++idleSpins < IDLE_SPIN_COUNT) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // 先声明即将休眠，再确认队列仍为空，避免与 post() 竞争丢失唤醒
+        uint32_t seen = mSignal.load();
+        mSleeping = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mQueue.empty() && mRunning) {
+            mSignal.wait(seen);
+        }
+        mSleeping = false;
+        idleSpins = 0;
+    }
+
+    flushBatch();
+    mLogger.debug("Event dispatcher worker ended");
+}
+
+void EventDispatcher::dispatch(OutboundEvent& event) {
+    const auto& config = mConfig;
+
+    if (event.type == EventType::Telemetry) {
+        dispatchTelemetry(event);
+        return;
+    }
+
+    // 玩家离开后不再需要其令牌桶和 ID
+    uint32_t leftPlayerId = 0;
+    if (event.type == EventType::PlayerLeave) {
+        if (!mPlayerRates.empty()) {
+            mPlayerRates.erase(event.playerName);
+        }
+        leftPlayerId = mServer.getPlayerIds().release(event.playerName);
+    }
+
+    // 全局开关是事件能否发出的上限
+    switch (event.type) {
+    case EventType::PlayerJoin:
+        if (!config.enablePlayerJoinBroadcast) return;
+        break;
+    case EventType::PlayerLeave:
+        if (!config.enablePlayerLeaveBroadcast) return;
+        break;
+    case EventType::PlayerChat:
+        if (!config.enablePlayerChatBroadcast || event.content.empty()) return;
+        break;
+    case EventType::Telemetry:
+        return;
+    }
+
+    // hook 和事件监听器都捕获到的聊天只广播先到的一次
+    if (mDeduplicateChat && event.type == EventType::PlayerChat
+        && mChatDeduplicator.isDuplicate(event.playerName, event.content, event.source, event.tick)) {
+        MCWS_TRACE(mLogger, "Dropping duplicate chat from {} (source {})", event.playerName,
+                   event.source == CaptureSource::PacketHook ? "hook" : "event");
+        mServer.getMetrics().chatDuplicatesDropped.add();
+        return;
+    }
+
+    if (event.type == EventType::PlayerChat && mChatRateLimit.enabled() && !admitChat(event)) {
+        return;
+    }
+
+    // 没有客户端订阅该类型时不必序列化；记录日志时仍需写入，供之后 resume 的客户端重放
+    if (!mJournal && !mServer.hasSubscribers(event.type)) {
+        return;
+    }
+
+    mServer.getMetrics().eventsBroadcast[static_cast<size_t>(event.type)].add();
+
+    // 只有存在支持 player_ids 的客户端时才分配 ID；之前没有分配过的玩家在首次出现时带上名称
+    uint32_t playerId = 0;
+    bool announceName = false;
+    if (mServer.hasPlayerIdClients()) {
+        playerId = event.type == EventType::PlayerLeave ? leftPlayerId
+                                                        : mServer.getPlayerIds().intern(event.playerName, announceName);
+    }
+
+    // 写入事件日志: 序号在序列化前确定，写入只是内存拷贝 (日志只记录完整编码)
+    bool withMsgPack = mServer.hasMsgPackClients();
+    EncodedMessage message;
+    if (mJournal) {
+        message = serialize(event, withMsgPack, mJournal->nextSeq(), playerId, announceName);
+        message.seq = mJournal->append(message.json);
+        if (message.seq == 0) {
+            message = serialize(event, withMsgPack, 0, playerId, announceName);
+        }
+    } else {
+        message = serialize(event, withMsgPack, 0, playerId, announceName);
+    }
+    MCWS_TRACE(mLogger, "Broadcasting JSON (tick {}, source {}): {}",
+               event.tick, event.source == CaptureSource::PacketHook ? "hook" : "event", message.json);
+
+    if (!mBatching) {
+        // 先提交再广播: 广播入队时该事件已可被重放，重放中的客户端据此去重
+        if (mJournal) {
+            mJournal->commit();
+        }
+        mServer.broadcast(std::move(message));
+        mServer.getMetrics().dispatchLatency.observe(std::chrono::steady_clock::now() - event.capturedAt);
+        return;
+    }
+
+    if (mBatch.empty()) {
+        mBatchDeadline = std::chrono::steady_clock::now() + mBatchInterval;
+    }
+    mBatch.push_back(std::move(message));
+    mBatchCapturedAt.push_back(event.capturedAt);
+    if (mBatch.size() >= mBatchMaxEvents) {
+        flushBatch();
+    }
+}
+
+bool EventDispatcher::admitChat(OutboundEvent& event) {
+    auto it = mPlayerRates.find(event.playerName);
+    if (it == mPlayerRates.end()) {
+        if (mPlayerRates.size() >= MAX_RATE_LIMITED_PLAYERS) {
+            for (auto entry = mPlayerRates.begin(); entry != mPlayerRates.end();) {
+                if (entry->second.suppressed == 0 && entry->second.bucket.idle()) {
+                    entry = mPlayerRates.erase(entry);
+                } else {
+                    ++entry;
+                }
+            }
+        }
+        it = mPlayerRates.try_emplace(event.playerName).first;
+    }
+
+    PlayerRate& rate = it->second;
+    if (!rate.bucket.tryAcquire(mChatRateLimit)) {
+        if (rate.suppressed++ == 0) {
+            mLogger.warn("Player {} exceeded the chat rate limit, suppressing messages", event.playerName);
+        }
+        mServer.getMetrics().chatRateLimited.add();
+        return false;
+    }
+    event.suppressed = rate.suppressed;
+    rate.suppressed = 0;
+    return true;
+}
+
+void EventDispatcher::dispatchTelemetry(const OutboundEvent& event) {
+    if (!mConfig.enableTelemetry || !event.telemetry) {
+        return;
+    }
+    // 没有订阅者时不编码；之后新订阅的客户端总是先收到关键帧，不依赖这里的状态
+    if (!mServer.hasSubscribers(EventType::Telemetry)) {
+        return;
+    }
+
+    bool withMsgPack = mServer.hasMsgPackClients();
+    bool keyframe = mTelemetryEncoder.encode(*event.telemetry, mTelemetryPayload);
+    MCWS_TRACE(mLogger, "Telemetry sample {} (tick {}, {} players): {} bytes{}", mTelemetryEncoder.sampleCount(),
+               event.telemetry->tick, event.telemetry->size(), mTelemetryPayload.size(), keyframe ? ", keyframe" : "");
+
+    mServer.getMetrics().eventsBroadcast[static_cast<size_t>(EventType::Telemetry)].add();
+    EncodedMessage message = serializeTelemetry(mTelemetryPayload, keyframe, withMsgPack);
+    if (keyframe) {
+        mServer.broadcastTelemetry(std::move(message), nullptr);
+    } else {
+        mServer.broadcastTelemetry(std::move(message), [this, withMsgPack] {
+            std::string payload;
+            mTelemetryEncoder.encodeKeyframe(payload);
+            return serializeTelemetry(payload, true, withMsgPack);
+        });
+    }
+    mServer.getMetrics().dispatchLatency.observe(std::chrono::steady_clock::now() - event.capturedAt);
+}
+
+void EventDispatcher::flushBatch() {
+    if (mBatch.empty()) {
+        return;
+    }
+
+    MCWS_TRACE(mLogger, "Flushing batch of {} events", mBatch.size());
+
+    // 整批一起提交，同一帧中的事件对重放方要么全部可见，要么全部不可见
+    if (mJournal) {
+        mJournal->commit();
+    }
+
+    if (mBatchAsArray) {
+        // 合并为一个数组消息，按客户端的订阅过滤后发出
+        mServer.broadcastArray(mBatch);
+    } else {
+        // 每个事件仍是独立的帧，但一次入队，由事件循环在同一次分散写中发出
+        mServer.broadcastBatch(mBatch);
+    }
+    mBatch.clear();
+
+    // 批量模式下的分发延迟包含在批次中等待的时间
+    auto now = std::chrono::steady_clock::now();
+    for (auto capturedAt : mBatchCapturedAt) {
+        mServer.getMetrics().dispatchLatency.observe(now - capturedAt);
+    }
+    mBatchCapturedAt.clear();
+}
+
+// 事件的 nlohmann::json 表示，用于生成 MessagePack 编码；playerId 为 0 表示完整编码
+static nlohmann::json buildEventDom(const OutboundEvent& event, uint64_t seq, uint32_t playerId, bool withName) {
+    nlohmann::json msg;
+    msg["type"] = EventTypeNames[static_cast<size_t>(event.type)];
+    if (withName) {
+        msg["player_name"] = event.playerName;
+    }
+    if (playerId != 0) {
+        msg["player_id"] = playerId;
+    }
+    if (event.type == EventType::PlayerChat) {
+        msg["content"] = event.content;
+        if (event.suppressed > 0) {
+            msg["suppressed"] = event.suppressed;
+        }
+    }
+    if (seq != 0) {
+        msg["seq"] = seq;
+    }
+    return msg;
+}
+
+// 直接写出与 buildEventDom(...).dump() 相同的 JSON (字段按键的字典序)
+// 字符串不是合法 UTF-8 时退回 dump()，保持原有的报错行为
+static std::string writeEventJson(const OutboundEvent& event, uint64_t seq, uint32_t playerId, bool withName) {
+    // 每个线程复用同一块缓冲区，结果按实际长度拷贝一次
+    thread_local std::string buffer;
+    buffer.clear();
+
+    JsonWriter writer(buffer);
+    if (event.type == EventType::PlayerChat) {
+        writer.string<"content">(event.content);
+    }
+    if (playerId != 0) {
+        writer.number<"player_id">(playerId);
+    }
+    if (withName) {
+        writer.string<"player_name">(event.playerName);
+    }
+    if (seq != 0) {
+        writer.number<"seq">(seq);
+    }
+    if (event.type == EventType::PlayerChat && event.suppressed > 0) {
+        writer.number<"suppressed">(event.suppressed);
+    }
+    writer.string<"type">(EventTypeNames[static_cast<size_t>(event.type)]);
+    if (!writer.finish()) {
+        return buildEventDom(event, seq, playerId, withName).dump();
+    }
+    return buffer;
+}
+
+EncodedMessage EventDispatcher::serialize(const OutboundEvent& event, bool withMsgPack, uint64_t seq,
+                                          uint32_t playerId, bool announceName) {
+    const bool withName = event.type != EventType::Telemetry;
+
+    EncodedMessage message;
+    message.json = writeEventJson(event, seq, 0, withName);
+    message.topic = topicBit(event.type);
+    message.player = event.playerName;
+    if (withMsgPack) {
+        std::vector<std::uint8_t> packed = nlohmann::json::to_msgpack(buildEventDom(event, seq, 0, withName));
+        message.msgpack.assign(packed.begin(), packed.end());
+    }
+
+    if (playerId != 0) {
+        const bool compactName = event.type == EventType::PlayerJoin || announceName;
+        message.compactJson = writeEventJson(event, seq, playerId, compactName);
+        if (withMsgPack) {
+            std::vector<std::uint8_t> packed = nlohmann::json::to_msgpack(buildEventDom(event, seq, playerId, compactName));
+            message.compactMsgpack.assign(packed.begin(), packed.end());
+        }
+    }
+    return message;
+}
+
+EncodedMessage EventDispatcher::serializeTelemetry(const std::string& payload, bool keyframe, bool withMsgPack) {
+    std::string data = base64Encode(reinterpret_cast<const unsigned char*>(payload.data()), payload.size());
+
+    EncodedMessage message;
+    JsonWriter writer(message.json);
+    writer.string<"data">(data);
+    writer.boolean<"keyframe">(keyframe);
+    writer.string<"type">("telemetry");
+    writer.finish();
+    message.topic = topicBit(EventType::Telemetry);
+    if (withMsgPack) {
+        nlohmann::json msg;
+        msg["type"] = "telemetry";
+        msg["keyframe"] = keyframe;
+        msg["data"] = nlohmann::json::binary(std::vector<std::uint8_t>(payload.begin(), payload.end()));
+        std::vector<std::uint8_t> packed = nlohmann::json::to_msgpack(msg);
+        message.msgpack.assign(packed.begin(), packed.end());
+    }
+    return message;
+}
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "mod/ChatDeduplicator.h"
+#include "mod/Config.h"
+#include "mod/Frame.h"
+#include "mod/Log.h"
+#include "mod/MpscQueue.h"
+#include "mod/OutboundEvent.h"
+#include "mod/Telemetry.h"
+#include "mod/TokenBucket.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace mclistener_ws_server {
+
+// 前向声明
+class EventJournal;
+class WebSocketServer;
+
+/**
+ * 游戏线程与网络层之间的事件管线
+ * 游戏线程通过 post() 把事件推入无锁 MPSC 队列，
+ * 专用工作线程负责过滤、序列化和扇出到 WebSocketServer
+ *
+ * 开启批量模式后，刷新间隔内到达的事件会合并后一次性发出:
+ * 合并为一个 JSON 数组帧，或多个帧在同一次 TCP 写入中发出
+ *
+ * 只有存在 MessagePack 客户端时才额外生成 MessagePack 编码
+ *
+ * chatCaptureMode 为 "both" 时，两种捕获方式得到的同一条聊天在这里去重，只广播一次；
+ * 每个玩家的聊天按令牌桶限流，被丢弃的条数附在该玩家下一条放行的聊天中
+ *
+ * 遥测采样不进入批次和事件日志，增量编码后立即广播给订阅了 telemetry 的客户端
+ *
+ * 有支持 player_ids 的客户端时，在 WebSocketServer 的玩家 ID 表中为事件涉及的玩家分配 ID，并额外生成紧凑编码
+ */
+class EventDispatcher {
+public:
+    EventDispatcher(WebSocketServer& server, const Config& config, Logger& logger);
+    ~EventDispatcher();
+
+    // 禁止拷贝
+    EventDispatcher(const EventDispatcher&) = delete;
+    EventDispatcher& operator=(const EventDispatcher&) = delete;
+
+    // 启动工作线程
+    void start();
+
+    // 处理完已入队的事件后停止工作线程
+    void stop();
+
+    // 提交事件 (任意线程，无锁)，队列满时丢弃并返回 false
+    bool post(OutboundEvent&& event);
+
+    // 因队列满被丢弃的事件数
+    uint64_t getDroppedCount() const { return mDropped; }
+
+    // 记录广播事件的日志，需在 start() 之前设置，nullptr 表示不记录
+    void setJournal(EventJournal* journal) { mJournal = journal; }
+
+    // 将事件序列化为 JSON 文本，需要时同时生成 MessagePack 编码 (公开供基准测试使用)
+    // seq 不为 0 时作为 "seq" 字段写入，供客户端 resume 使用
+    // playerId 不为 0 时同时生成以 "player_id" 代替 "player_name" 的紧凑编码，
+    // player_join 和 announceName 为 true (ID 首次出现) 时紧凑编码中仍带上名称
+    static EncodedMessage serialize(const OutboundEvent& event, bool withMsgPack, uint64_t seq = 0,
+                                    uint32_t playerId = 0, bool announceName = false);
+
+    // 把遥测编码结果包装为消息: JSON 中 "data" 为 Base64 字符串，MessagePack 中为 bin
+    static EncodedMessage serializeTelemetry(const std::string& payload, bool keyframe, bool withMsgPack);
+
+private:
+    // 工作线程函数
+    void run();
+
+    // 处理单个事件: 过滤、去重、限流、序列化、广播或加入当前批次
+    void dispatch(OutboundEvent& event);
+
+    // 玩家聊天限流，返回 false 表示丢弃；放行时把之前丢弃的条数写入 event.suppressed
+    bool admitChat(OutboundEvent& event);
+
+    // 编码并广播一次遥测采样
+    void dispatchTelemetry(const OutboundEvent& event);
+
+    // 发出当前批次
+    void flushBatch();
+
+    WebSocketServer& mServer;
+    const Config& mConfig;
+    Logger& mLogger;
+    EventJournal* mJournal = nullptr;
+
+    MpscQueue<OutboundEvent> mQueue;
+    std::thread mWorker;
+    std::atomic<bool> mRunning{false};
+
+    // 工作线程空闲时在 mSignal 上等待；生产者只在 mSleeping 为 true 时才需要唤醒
+    std::atomic<bool> mSleeping{false};
+    std::atomic<uint32_t> mSignal{0};
+
+    std::atomic<uint64_t> mDropped{0};
+
+    // "both" 捕获模式下的聊天去重，只由工作线程访问
+    bool mDeduplicateChat = false;
+    ChatDeduplicator mChatDeduplicator;
+
+    // 每个玩家的聊天令牌桶和尚未报告的丢弃条数，只由工作线程访问，玩家离开时移除
+    struct PlayerRate {
+        TokenBucket bucket;
+        uint32_t suppressed = 0;
+    };
+    RateLimit mChatRateLimit;
+    std::unordered_map<std::string, PlayerRate> mPlayerRates;
+
+    // 遥测增量编码状态，只由工作线程访问
+    TelemetryEncoder mTelemetryEncoder;
+    std::string mTelemetryPayload;
+
+    // 批量模式，只由工作线程访问
+    bool mBatching = false;
+    bool mBatchAsArray = true;
+    size_t mBatchMaxEvents = 32;
+    std::chrono::milliseconds mBatchInterval{50};
+    std::vector<EncodedMessage> mBatch;
+    std::vector<std::chrono::steady_clock::time_point> mBatchCapturedAt;
+    std::chrono::steady_clock::time_point mBatchDeadline;
+};
+
+} // namespace mclistener_ws_server
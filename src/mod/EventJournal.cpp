@@ -0,0 +1,275 @@
+#include "mod/EventJournal.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+
+namespace mclistener_ws_server {
+
+static constexpr char   SEGMENT_MAGIC[8]   = {'M', 'C', 'W', 'S', 'J', 'N', 'L', '1'};
+static constexpr size_t SEGMENT_HEADER_SIZE = 32;
+static constexpr size_t RECORD_HEADER_SIZE  = 16;
+static constexpr size_t MIN_SEGMENT_SIZE    = 64 * 1024;
+
+static size_t alignRecord(size_t size) {
+    return (size + 7) & ~size_t{7};
+}
+
+struct RecordHeader {
+    uint32_t length;
+    uint32_t crc;
+    uint64_t seq;
+};
+
+// 读取 offset 处的记录头，越界时返回 false
+static bool readRecordHeader(const MappedFile& file, size_t offset, RecordHeader& header) {
+    if (offset + RECORD_HEADER_SIZE > file.size()) {
+        return false;
+    }
+    std::memcpy(&header, file.data() + offset, RECORD_HEADER_SIZE);
+    return header.length != 0 && offset + RECORD_HEADER_SIZE + header.length <= file.size();
+}
+
+EventJournal::EventJournal(std::filesystem::path directory, size_t retentionBytes, Logger& logger)
+    : mDirectory(std::move(directory)), mLogger(logger) {
+    // 分段大小按页对齐
+    mSegmentSize = std::max(retentionBytes / SegmentCount, MIN_SEGMENT_SIZE);
+    mSegmentSize = (mSegmentSize + 4095) & ~size_t{4095};
+}
+
+EventJournal::~EventJournal() {
+    close();
+}
+
+bool EventJournal::open() {
+    std::error_code ec;
+    std::filesystem::create_directories(mDirectory, ec);
+    if (ec) {
+        mLogger.error("Failed to create event journal directory {}: {}", mDirectory.string(), ec.message());
+        return false;
+    }
+
+    // 恢复各分段，首条序号最大的分段是上次的写入分段
+    bool found = false;
+    uint64_t writeLastSeq = 0;
+    for (size_t i = 0; i < SegmentCount; ++i) {
+        Segment& segment = mSegments[i];
+        auto path = mDirectory / ("segment-" + std::to_string(i) + ".jnl");
+        if (!segment.file.open(path, mSegmentSize)) {
+            mLogger.error("Failed to map event journal segment {}", path.string());
+            close();
+            return false;
+        }
+
+        uint64_t lastSeq = 0;
+        size_t end = recoverSegment(segment, lastSeq);
+        if (segment.firstSeq != 0 && (!found || segment.firstSeq > mSegments[mWriteSegment].firstSeq)) {
+            found = true;
+            mWriteSegment = i;
+            mWriteOffset = end;
+            writeLastSeq = lastSeq;
+        }
+    }
+
+    if (found) {
+        mNextSeq = writeLastSeq + 1;
+    } else {
+        mWriteSegment = 0;
+        mWriteOffset = SEGMENT_HEADER_SIZE;
+        mNextSeq = 1;
+        std::lock_guard<std::mutex> lock(mMutex);
+        writeHeader(mSegments[0], mNextSeq);
+    }
+    mCommittedSeq.store(mNextSeq - 1, std::memory_order_release);
+
+    uint64_t first = firstSeq();
+    if (mNextSeq > first) {
+        mLogger.info("Event journal opened at {}: {} events retained (seq {}-{})", mDirectory.string(),
+                     mNextSeq - first, first, mNextSeq - 1);
+    } else {
+        mLogger.info("Event journal opened at {}, next seq {}", mDirectory.string(), mNextSeq);
+    }
+    mLogger.debug("Event journal: {} segments x {} KB", SegmentCount, mSegmentSize / 1024);
+    return true;
+}
+
+void EventJournal::close() {
+    for (auto& segment : mSegments) {
+        segment.file.flush();
+        segment.file.close();
+        segment.firstSeq = 0;
+    }
+}
+
+size_t EventJournal::recoverSegment(Segment& segment, uint64_t& lastSeq) {
+    const MappedFile& file = segment.file;
+    segment.firstSeq = 0;
+    if (std::memcmp(file.data(), SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0) {
+        return SEGMENT_HEADER_SIZE;
+    }
+    std::memcpy(&segment.firstSeq, file.data() + sizeof(SEGMENT_MAGIC), sizeof(uint64_t));
+
+    // 逐条校验，遇到序号不连续、越界或 CRC 不符 (写入中途崩溃或旧数据) 即停止
+    uint64_t expected = segment.firstSeq;
+    size_t offset = SEGMENT_HEADER_SIZE;
+    RecordHeader header;
+    while (segment.firstSeq != 0 && readRecordHeader(file, offset, header) && header.seq == expected) {
+        const unsigned char* payload = file.data() + offset + RECORD_HEADER_SIZE;
+        if (static_cast<uint32_t>(crc32(0, payload, header.length)) != header.crc) {
+            break;
+        }
+        ++expected;
+        offset += alignRecord(RECORD_HEADER_SIZE + header.length);
+    }
+    lastSeq = expected - 1;
+    return offset;
+}
+
+void EventJournal::writeHeader(Segment& segment, uint64_t firstSeq) {
+    unsigned char* data = segment.file.data();
+    std::memset(data, 0, SEGMENT_HEADER_SIZE + RECORD_HEADER_SIZE);
+    std::memcpy(data, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+    std::memcpy(data + sizeof(SEGMENT_MAGIC), &firstSeq, sizeof(firstSeq));
+    segment.firstSeq = firstSeq;
+}
+
+uint64_t EventJournal::append(std::string_view record) {
+    size_t size = alignRecord(RECORD_HEADER_SIZE + record.size());
+    if (record.empty() || SEGMENT_HEADER_SIZE + size > mSegmentSize) {
+        mLogger.warn("Event of {} bytes does not fit in a journal segment, not journaled", record.size());
+        return 0;
+    }
+    if (mWriteOffset + size > mSegmentSize) {
+        rollSegment();
+    }
+
+    RecordHeader header;
+    header.length = static_cast<uint32_t>(record.size());
+    header.crc = static_cast<uint32_t>(
+        crc32(0, reinterpret_cast<const unsigned char*>(record.data()), static_cast<uInt>(record.size())));
+    header.seq = mNextSeq;
+
+    unsigned char* data = mSegments[mWriteSegment].file.data() + mWriteOffset;
+    std::memcpy(data, &header, RECORD_HEADER_SIZE);
+    std::memcpy(data + RECORD_HEADER_SIZE, record.data(), record.size());
+    mWriteOffset += size;
+    return mNextSeq++;
+}
+
+void EventJournal::commit() {
+    mCommittedSeq.store(mNextSeq - 1, std::memory_order_release);
+}
+
+void EventJournal::rollSegment() {
+    // 写满的分段交给操作系统异步回写
+    mSegments[mWriteSegment].file.flush();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mWriteSegment = (mWriteSegment + 1) % SegmentCount;
+    mWriteOffset = SEGMENT_HEADER_SIZE;
+    writeHeader(mSegments[mWriteSegment], mNextSeq);
+}
+
+uint64_t EventJournal::firstSeq() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return firstSeqLocked();
+}
+
+uint64_t EventJournal::firstSeqLocked() const {
+    uint64_t first = 0;
+    for (const auto& segment : mSegments) {
+        if (segment.firstSeq != 0 && (first == 0 || segment.firstSeq < first)) {
+            first = segment.firstSeq;
+        }
+    }
+    return first;
+}
+
+bool EventJournal::locateLocked(Cursor& cursor) {
+    uint64_t committed = mCommittedSeq.load(std::memory_order_acquire);
+    cursor.positioned = false;
+
+    // 首条序号不大于目标的分段中最新的一个，从头顺序查找
+    const Segment* best = nullptr;
+    for (const auto& segment : mSegments) {
+        if (segment.firstSeq != 0 && segment.firstSeq <= cursor.seq && (!best || segment.firstSeq > best->firstSeq)) {
+            best = &segment;
+        }
+    }
+    if (best) {
+        size_t offset = SEGMENT_HEADER_SIZE;
+        RecordHeader header;
+        while (readRecordHeader(best->file, offset, header) && header.seq <= cursor.seq && header.seq <= committed) {
+            if (header.seq == cursor.seq) {
+                cursor.segment = static_cast<size_t>(best - mSegments.data());
+                cursor.offset = offset;
+                cursor.positioned = true;
+                return true;
+            }
+            offset += alignRecord(RECORD_HEADER_SIZE + header.length);
+        }
+    }
+
+    // 目标记录已不存在 (被回收或日志有缺口)，跳到之后最早的分段
+    const Segment* next = nullptr;
+    for (const auto& segment : mSegments) {
+        if (segment.firstSeq > cursor.seq && segment.firstSeq <= committed
+            && (!next || segment.firstSeq < next->firstSeq)) {
+            next = &segment;
+        }
+    }
+    if (!next) {
+        return false;
+    }
+    cursor.seq = next->firstSeq;
+    cursor.segment = static_cast<size_t>(next - mSegments.data());
+    cursor.offset = SEGMENT_HEADER_SIZE;
+    cursor.positioned = true;
+    return true;
+}
+
+size_t EventJournal::read(Cursor& cursor, size_t maxRecords, std::vector<std::string>& out) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    uint64_t committed = mCommittedSeq.load(std::memory_order_acquire);
+
+    uint64_t first = firstSeqLocked();
+    if (cursor.seq < first) {
+        cursor.seq = first;
+        cursor.positioned = false;
+    }
+
+    size_t count = 0;
+    while (count < maxRecords && cursor.seq <= committed) {
+        if (!cursor.positioned && !locateLocked(cursor)) {
+            break;
+        }
+
+        const Segment& segment = mSegments[cursor.segment];
+        RecordHeader header;
+        if (!readRecordHeader(segment.file, cursor.offset, header) || header.seq != cursor.seq) {
+            // 当前分段已读完，下一条通常在环中的下一个分段开头
+            size_t next = (cursor.segment + 1) % SegmentCount;
+            if (mSegments[next].firstSeq == cursor.seq) {
+                cursor.segment = next;
+                cursor.offset = SEGMENT_HEADER_SIZE;
+            } else {
+                cursor.positioned = false;
+                if (!locateLocked(cursor)) {
+                    break;
+                }
+            }
+            continue;
+        }
+
+        out.emplace_back(reinterpret_cast<const char*>(segment.file.data()) + cursor.offset + RECORD_HEADER_SIZE,
+                         header.length);
+        cursor.offset += alignRecord(RECORD_HEADER_SIZE + header.length);
+        ++cursor.seq;
+        ++count;
+    }
+    return count;
+}
+
+} // namespace mclistener_ws_server
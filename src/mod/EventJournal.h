@@ -0,0 +1,115 @@
+#pragma once
+
+#include "mod/Log.h"
+#include "mod/MappedFile.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mclistener_ws_server {
+
+/**
+ * 出站事件日志 (journal)
+ * 每条广播的事件按递增的序号追加到数据目录下的内存映射文件中，
+ * 文件组成固定数量分段的环: 当前分段写满后回收最旧的分段，总大小即保留上限
+ *
+ * 客户端断线重连后发送 resume 消息带上最后收到的序号，服务器从日志中顺序重放之后的事件
+ *
+ * 线程模型:
+ * - 只有 EventDispatcher 的工作线程调用 append() / commit()，写入就是内存拷贝，
+ *   只有切换分段时才加锁；游戏线程不接触日志
+ * - 任意线程可调用 read()，只能读到已 commit() 的记录
+ *
+ * 分段格式: 32 字节头 (魔数 + 首条记录序号)，之后是连续的记录，
+ * 每条记录为 长度(4) + CRC32(4) + 序号(8) + 负载，按 8 字节对齐
+ */
+class EventJournal {
+public:
+    // 分段数，每个分段大小为保留上限 / 分段数
+    static constexpr size_t SegmentCount = 8;
+
+    // 读取位置，由读取方保存，初始只需设置 seq
+    struct Cursor {
+        uint64_t seq     = 0; // 下一条要读取的序号
+        size_t   segment = 0;
+        size_t   offset  = 0;
+        bool     positioned = false;
+    };
+
+    EventJournal(std::filesystem::path directory, size_t retentionBytes, Logger& logger);
+    ~EventJournal();
+
+    // 禁止拷贝
+    EventJournal(const EventJournal&) = delete;
+    EventJournal& operator=(const EventJournal&) = delete;
+
+    // 打开或创建分段文件，恢复已有记录并从最后一条之后继续编号
+    bool open();
+
+    // 回写并关闭所有分段
+    void close();
+
+    // 下一条 append() 将得到的序号 (仅写入线程)
+    uint64_t nextSeq() const { return mNextSeq; }
+
+    // 追加一条记录，返回其序号；记录超过分段容量时丢弃并返回 0 (仅写入线程)
+    uint64_t append(std::string_view record);
+
+    // 使已追加的记录对读取方可见 (仅写入线程)
+    void commit();
+
+    // 已提交的最后一条记录的序号，0 表示没有记录
+    uint64_t lastSeq() const { return mCommittedSeq.load(std::memory_order_acquire); }
+
+    // 仍保留的最早一条记录的序号
+    uint64_t firstSeq() const;
+
+    // 从 cursor.seq 开始最多读取 maxRecords 条已提交的记录追加到 out，返回读取条数
+    // cursor.seq 早于保留范围时从最早的记录开始
+    size_t read(Cursor& cursor, size_t maxRecords, std::vector<std::string>& out);
+
+private:
+    struct Segment {
+        MappedFile file;
+        uint64_t   firstSeq = 0; // 0 表示空分段
+    };
+
+    // 恢复单个分段，返回有效记录结束的位置和最后一条记录的序号
+    size_t recoverSegment(Segment& segment, uint64_t& lastSeq);
+
+    // 当前分段写满，切换到下一个分段 (回收其中的旧记录)
+    void rollSegment();
+
+    // 写入分段头
+    void writeHeader(Segment& segment, uint64_t firstSeq);
+
+    // 把 cursor 定位到 cursor.seq 所在的记录，该序号已不存在时跳到之后最早的记录，调用方需持有 mMutex
+    bool locateLocked(Cursor& cursor);
+
+    // 仍保留的最早记录序号，调用方需持有 mMutex
+    uint64_t firstSeqLocked() const;
+
+    std::filesystem::path mDirectory;
+    size_t mSegmentSize;
+    Logger& mLogger;
+
+    std::array<Segment, SegmentCount> mSegments;
+
+    // 只由写入线程访问
+    size_t   mWriteSegment = 0;
+    size_t   mWriteOffset  = 0;
+    uint64_t mNextSeq      = 1;
+
+    std::atomic<uint64_t> mCommittedSeq{0};
+
+    // 保护分段的 firstSeq 和分段回收，读取时持有以免读到正被回收的分段
+    mutable std::mutex mMutex;
+};
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,60 @@
+#include "mod/Frame.h"
+
+namespace mclistener_ws_server {
+
+std::shared_ptr<const OutboundFrame> OutboundFrame::text(std::string payload, bool compressed) {
+    return std::make_shared<const OutboundFrame>(0x1, true, std::move(payload), compressed);
+}
+
+std::shared_ptr<const OutboundFrame> OutboundFrame::binary(std::string payload, bool compressed) {
+    return std::make_shared<const OutboundFrame>(0x2, true, std::move(payload), compressed);
+}
+
+std::shared_ptr<const OutboundFrame> OutboundFrame::control(unsigned char opcode, std::string payload) {
+    return std::make_shared<const OutboundFrame>(opcode, true, std::move(payload));
+}
+
+std::shared_ptr<const OutboundFrame> OutboundFrame::raw(std::string data) {
+    return std::make_shared<const OutboundFrame>(0x0, false, std::move(data));
+}
+
+std::shared_ptr<const OutboundFrame> OutboundFrame::lengthPrefixed(unsigned char opcode, std::string payload) {
+    return std::make_shared<const OutboundFrame>(opcode, true, std::move(payload), false, Framing::LengthPrefixed);
+}
+
+OutboundFrame::OutboundFrame(unsigned char opcode, bool withHeader, std::string payload, bool compressed,
+                             Framing framing)
+    : mPayload(std::move(payload)) {
+    if (!withHeader) {
+        return;
+    }
+    mOpcode = opcode & 0x0F;
+
+    size_t length = mPayload.size();
+
+    if (framing == Framing::LengthPrefixed) {
+        for (int i = 3; i >= 0; --i) {
+            mHeader[mHeaderSize++] = static_cast<unsigned char>((static_cast<uint32_t>(length) >> (i * 8)) & 0xFF);
+        }
+        mHeader[mHeaderSize++] = mOpcode;
+        return;
+    }
+
+    // FIN + RSV1 (permessage-deflate) + opcode
+    mHeader[mHeaderSize++] = static_cast<unsigned char>(0x80 | (compressed ? 0x40 : 0x00) | (opcode & 0x0F));
+
+    if (length <= 125) {
+        mHeader[mHeaderSize++] = static_cast<unsigned char>(length);
+    } else if (length <= 65535) {
+        mHeader[mHeaderSize++] = 126;
+        mHeader[mHeaderSize++] = static_cast<unsigned char>((length >> 8) & 0xFF);
+        mHeader[mHeaderSize++] = static_cast<unsigned char>(length & 0xFF);
+    } else {
+        mHeader[mHeaderSize++] = 127;
+        for (int i = 7; i >= 0; --i) {
+            mHeader[mHeaderSize++] = static_cast<unsigned char>((static_cast<uint64_t>(length) >> (i * 8)) & 0xFF);
+        }
+    }
+}
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace mclistener_ws_server {
+
+// 消息编码: 默认 JSON 文本帧，协商子协议后使用 MessagePack 二进制帧
+enum class MessageEncoding { Json, MsgPack };
+
+// 帧格式: WebSocket (RFC 6455)，或本机传输 (Unix 域 socket) 使用的长度前缀帧
+// 长度前缀帧为 4 字节负载长度 (大端) + 1 字节 opcode + 负载，opcode 与 WebSocket 相同，没有掩码、分片和压缩
+enum class Framing : uint8_t { WebSocket, LengthPrefixed };
+
+// 长度前缀帧的帧头长度
+inline constexpr size_t LengthPrefixedHeaderSize = 5;
+
+// 同一条消息的各种编码，msgpack 为空表示当前没有客户端需要该编码
+struct EncodedMessage {
+    std::string json;
+    std::string msgpack;
+    uint64_t    seq = 0; // 事件日志序号 (批量数组取其中最大的)，0 表示未记录到日志
+    uint32_t    topic = 0; // 事件类型对应的订阅位，0 表示不是游戏事件，所有客户端都接收
+    std::string player;    // 事件涉及的玩家，用于订阅过滤
+    // 发给支持 player_ids 的客户端的紧凑编码 (以玩家 ID 代替名称)，为空表示与完整编码相同
+    std::string compactJson;
+    std::string compactMsgpack;
+};
+
+/**
+ * 已编码的不可变出站数据 (WebSocket 帧头 + 负载)
+ * 广播时只构造一次，通过引用计数在所有客户端发送队列之间共享，
+ * 发送时帧头和负载作为两个分段直接交给 writev / WSASend，不再为每个客户端拷贝
+ */
+class OutboundFrame {
+public:
+    // WebSocket 帧头最大长度: 2 字节基础头 + 8 字节扩展长度
+    static constexpr size_t MaxHeaderSize = 10;
+
+    // 构造文本帧 (opcode 0x1)，compressed 表示负载已按 permessage-deflate 压缩 (设置 RSV1)
+    static std::shared_ptr<const OutboundFrame> text(std::string payload, bool compressed = false);
+
+    // 构造二进制帧 (opcode 0x2)
+    static std::shared_ptr<const OutboundFrame> binary(std::string payload, bool compressed = false);
+
+    // 构造控制帧 (close 0x8 / ping 0x9 / pong 0xA)，负载不超过 125 字节
+    static std::shared_ptr<const OutboundFrame> control(unsigned char opcode, std::string payload);
+
+    // 构造不带帧头的原始数据 (如 HTTP 握手响应)
+    static std::shared_ptr<const OutboundFrame> raw(std::string data);
+
+    // 构造本机传输使用的长度前缀帧 (数据帧和控制帧相同)
+    static std::shared_ptr<const OutboundFrame> lengthPrefixed(unsigned char opcode, std::string payload);
+
+    OutboundFrame(unsigned char opcode, bool withHeader, std::string payload, bool compressed = false,
+                  Framing framing = Framing::WebSocket);
+
+    OutboundFrame(const OutboundFrame&) = delete;
+    OutboundFrame& operator=(const OutboundFrame&) = delete;
+
+    const unsigned char* header() const { return mHeader; }
+    size_t headerSize() const { return mHeaderSize; }
+
+    const std::string& payload() const { return mPayload; }
+
+    // 帧的 opcode，原始数据返回 0
+    unsigned char opcode() const { return mOpcode; }
+
+    // 构造时间，用于统计从广播到写出的延迟
+    std::chrono::steady_clock::time_point createdAt() const { return mCreatedAt; }
+
+    // 帧的总字节数
+    size_t size() const { return mHeaderSize + mPayload.size(); }
+
+private:
+    unsigned char mHeader[MaxHeaderSize];
+    uint8_t mHeaderSize = 0;
+    unsigned char mOpcode = 0;
+    std::string mPayload;
+    std::chrono::steady_clock::time_point mCreatedAt = std::chrono::steady_clock::now();
+};
+
+using FrameRef = std::shared_ptr<const OutboundFrame>;
+
+} // namespace mclistener_ws_server
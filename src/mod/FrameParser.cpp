@@ -0,0 +1,204 @@
+#include "mod/FrameParser.h"
+#include "mod/Unmask.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace mclistener_ws_server {
+
+// 消息缓冲区在处理完大消息后收缩回的容量上限
+static constexpr size_t MESSAGE_BUFFER_SHRINK_THRESHOLD = 16 * 1024;
+
+// 收到帧头时最多为负载预留的容量
+static constexpr size_t MESSAGE_RESERVE_LIMIT = 4 * 1024;
+
+FrameParser::FrameParser(size_t maxMessageSize, bool allowCompressed, Framing framing)
+    : mMaxMessageSize(maxMessageSize), mAllowCompressed(allowCompressed), mFraming(framing) {
+    mHeaderNeeded = initialHeaderSize();
+}
+
+size_t FrameParser::feed(const char* data, size_t length) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    size_t consumed = 0;
+
+    while (mStatus == Status::NeedMore && consumed < length) {
+        if (!mInPayload) {
+            // 累积帧头，长度字段决定完整帧头的长度
+            size_t take = std::min(mHeaderNeeded - mHeaderSize, length - consumed);
+            std::memcpy(mHeader + mHeaderSize, bytes + consumed, take);
+            mHeaderSize += take;
+            consumed += take;
+            if (mHeaderSize < mHeaderNeeded) {
+                break;
+            }
+            if (mFraming == Framing::WebSocket && mHeaderSize == 2) {
+                unsigned char lengthField = mHeader[1] & 0x7F;
+                mHeaderNeeded = 2 + (lengthField == 126 ? 2 : lengthField == 127 ? 8 : 0) + ((mHeader[1] & 0x80) ? 4 : 0);
+                if (mHeaderNeeded > 2) {
+                    continue;
+                }
+            }
+            onHeaderComplete();
+            continue;
+        }
+
+        // 负载直接解掩码写入目标缓冲区，掩码位置跨 feed() 调用保持
+        size_t take = static_cast<size_t>(std::min<uint64_t>(mPayloadRemaining, length - consumed));
+        std::string& target = (mOpcode & 0x08) ? mControl : mMessage;
+        size_t start = target.size();
+        target.resize(start + take);
+        if (mFraming == Framing::WebSocket) {
+            unmaskPayload(target.data() + start, data + consumed, take, mMask, mMaskOffset);
+            mMaskOffset = (mMaskOffset + take) & 3;
+        } else {
+            std::memcpy(target.data() + start, data + consumed, take);
+        }
+        consumed += take;
+        mPayloadRemaining -= take;
+
+        if (mPayloadRemaining == 0) {
+            onFrameComplete();
+        }
+    }
+
+    return consumed;
+}
+
+bool FrameParser::onHeaderComplete() {
+    // 下一帧从新的帧头开始
+    size_t headerSize = mHeaderSize;
+    mHeaderSize = 0;
+    mHeaderNeeded = initialHeaderSize();
+
+    uint64_t payloadLength = 0;
+    bool rsv1 = false;
+    if (mFraming == Framing::LengthPrefixed) {
+        // 4 字节负载长度 (大端) + 1 字节 opcode，每帧都是完整的消息
+        for (int i = 0; i < 4; ++i) {
+            payloadLength = (payloadLength << 8) | mHeader[i];
+        }
+        mOpcode = mHeader[4];
+        mFin = true;
+        if (mOpcode & 0xF0) {
+            fail(CloseCode::ProtocolError);
+            return false;
+        }
+    } else {
+        unsigned char b0 = mHeader[0];
+        unsigned char b1 = mHeader[1];
+        mFin = (b0 & 0x80) != 0;
+        mOpcode = b0 & 0x0F;
+        rsv1 = (b0 & 0x40) != 0;
+
+        // RSV2 / RSV3 未定义；客户端发出的帧必须带掩码
+        if ((b0 & 0x30) != 0 || (b1 & 0x80) == 0) {
+            fail(CloseCode::ProtocolError);
+            return false;
+        }
+
+        payloadLength = b1 & 0x7F;
+        if (payloadLength == 126) {
+            payloadLength = (static_cast<uint64_t>(mHeader[2]) << 8) | mHeader[3];
+        } else if (payloadLength == 127) {
+            payloadLength = 0;
+            for (int i = 0; i < 8; ++i) {
+                payloadLength = (payloadLength << 8) | mHeader[2 + i];
+            }
+            // 最高位必须为 0
+            if (payloadLength >> 63) {
+                fail(CloseCode::ProtocolError);
+                return false;
+            }
+        }
+        std::memcpy(mMask, mHeader + headerSize - 4, 4);
+    }
+    bool control = (mOpcode & 0x08) != 0;
+
+    if (control) {
+        // 控制帧不能分片，负载不超过 125 字节，也不能压缩
+        if ((mOpcode != 0x8 && mOpcode != 0x9 && mOpcode != 0xA) || !mFin || payloadLength > 125 || rsv1) {
+            fail(CloseCode::ProtocolError);
+            return false;
+        }
+    } else {
+        if (mOpcode == 0x0) {
+            // 延续帧必须跟在未结束的消息之后，RSV1 只出现在首帧
+            if (!mInMessage || rsv1) {
+                fail(CloseCode::ProtocolError);
+                return false;
+            }
+        } else if (mOpcode == 0x1 || mOpcode == 0x2) {
+            if (mInMessage || (rsv1 && !mAllowCompressed)) {
+                fail(CloseCode::ProtocolError);
+                return false;
+            }
+            mInMessage = true;
+            mMessageOpcode = mOpcode;
+            mMessageCompressed = rsv1;
+        } else {
+            fail(CloseCode::ProtocolError);
+            return false;
+        }
+
+        // 整条消息 (所有分片之和) 不能超过上限
+        if (payloadLength > mMaxMessageSize - mMessage.size()) {
+            fail(CloseCode::MessageTooBig);
+            return false;
+        }
+        // 帧头声明的长度不可信: 只预留一小段，其余随负载到达按需增长，
+        // 只发帧头不发负载的连接不会占用整条消息上限的内存
+        mMessage.reserve(mMessage.size() + static_cast<size_t>(std::min<uint64_t>(payloadLength, MESSAGE_RESERVE_LIMIT)));
+    }
+
+    mPayloadRemaining = payloadLength;
+    mMaskOffset = 0;
+    mInPayload = true;
+    if (payloadLength == 0) {
+        onFrameComplete();
+    }
+    return true;
+}
+
+void FrameParser::onFrameComplete() {
+    mInPayload = false;
+
+    if (mOpcode & 0x08) {
+        mReadyOpcode = mOpcode;
+        mReadyIsControl = true;
+        mStatus = Status::Ready;
+        return;
+    }
+
+    // 分片消息等待后续延续帧
+    if (!mFin) {
+        return;
+    }
+
+    mReadyOpcode = mMessageOpcode;
+    mReadyIsControl = false;
+    mInMessage = false;
+    mStatus = Status::Ready;
+}
+
+void FrameParser::next() {
+    if (mStatus != Status::Ready) {
+        return;
+    }
+
+    if (mReadyIsControl) {
+        mControl.clear();
+    } else if (mMessage.capacity() > MESSAGE_BUFFER_SHRINK_THRESHOLD) {
+        // 处理完大消息后释放多余的缓冲区
+        std::string().swap(mMessage);
+    } else {
+        mMessage.clear();
+    }
+    mStatus = Status::NeedMore;
+}
+
+void FrameParser::fail(CloseCode code) {
+    mStatus = Status::Error;
+    mErrorCode = code;
+}
+
+} // namespace mclistener_ws_server
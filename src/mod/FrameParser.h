@@ -0,0 +1,105 @@
+#pragma once
+
+#include "mod/Frame.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace mclistener_ws_server {
+
+// 关闭帧状态码 (RFC 6455 7.4.1)
+enum class CloseCode : uint16_t {
+    Normal          = 1000,
+    ProtocolError   = 1002,
+    UnsupportedData = 1003,
+    InvalidPayload  = 1007,
+    MessageTooBig   = 1009,
+};
+
+/**
+ * 可恢复的增量 WebSocket 帧解析器 (客户端 → 服务端方向)
+ *
+ * 每个连接一个实例，接受任意切分的字节流: 帧头在内部小缓冲区中累积，
+ * 负载直接解掩码写入消息缓冲区，不再经过中间缓冲区拷贝。
+ * 分片消息会被重新拼接，控制帧 (close / ping / pong) 可以穿插在分片之间单独交付。
+ * 本机传输的连接使用 Framing::LengthPrefixed，帧头固定 5 字节，之后的校验和交付方式相同。
+ *
+ * 用法:
+ *   offset += parser.feed(data + offset, length - offset);
+ *   if (parser.status() == FrameParser::Status::Ready) { 处理 opcode() / payload(); parser.next(); }
+ */
+class FrameParser {
+public:
+    enum class Status { NeedMore, Ready, Error };
+
+    explicit FrameParser(size_t maxMessageSize = 1024 * 1024, bool allowCompressed = false,
+                         Framing framing = Framing::WebSocket);
+
+    // 处理一段数据，返回消费的字节数；一帧就绪或出错时立即返回，剩余数据留给下一次调用
+    size_t feed(const char* data, size_t length);
+
+    Status status() const { return mStatus; }
+
+    // 就绪帧的 opcode: 数据消息为 0x1 / 0x2 (分片消息取首帧的 opcode)，控制帧为 0x8 / 0x9 / 0xA
+    unsigned char opcode() const { return mReadyOpcode; }
+
+    // 就绪帧的负载 (已解掩码)，调用方可以直接移走
+    std::string& payload() { return mReadyIsControl ? mControl : mMessage; }
+
+    // 就绪的数据消息是否设置了 RSV1 (permessage-deflate)
+    bool compressed() const { return !mReadyIsControl && mMessageCompressed; }
+
+    // 出错时应当在关闭帧中返回的状态码
+    CloseCode errorCode() const { return mErrorCode; }
+
+    // 释放当前就绪帧，继续解析
+    void next();
+
+private:
+    // 帧头接收完整后校验并切换到负载状态
+    bool onHeaderComplete();
+
+    // 当前帧负载接收完毕
+    void onFrameComplete();
+
+    void fail(CloseCode code);
+
+    // 新帧头的初始长度: WebSocket 先读 2 字节基础头，长度前缀帧头固定长度
+    size_t initialHeaderSize() const { return mFraming == Framing::WebSocket ? 2 : LengthPrefixedHeaderSize; }
+
+    size_t mMaxMessageSize;
+    bool mAllowCompressed;
+    Framing mFraming;
+
+    Status mStatus = Status::NeedMore;
+    CloseCode mErrorCode = CloseCode::ProtocolError;
+
+    // 当前帧头: 2 字节基础头 + 最多 8 字节扩展长度 + 4 字节掩码
+    unsigned char mHeader[14];
+    size_t mHeaderSize = 0;
+    size_t mHeaderNeeded = 2;
+    bool mInPayload = false;
+
+    // 当前帧的信息
+    bool mFin = false;
+    unsigned char mOpcode = 0;
+    unsigned char mMask[4] = {0};
+    uint64_t mPayloadRemaining = 0;
+    size_t mMaskOffset = 0;
+
+    // 正在拼接的数据消息
+    bool mInMessage = false;
+    unsigned char mMessageOpcode = 0;
+    bool mMessageCompressed = false;
+    std::string mMessage;
+
+    // 控制帧负载 (最多 125 字节)
+    std::string mControl;
+
+    // 就绪帧
+    unsigned char mReadyOpcode = 0;
+    bool mReadyIsControl = false;
+};
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,167 @@
+#include "mod/Handshake.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace mclistener_ws_server {
+
+// WebSocket GUID (RFC 6455)
+static const char* WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// 在请求头中查找指定字段 (不区分大小写)，多次出现的同名字段以 ", " 连接
+std::string getHeaderValue(const std::string& request, const std::string& name) {
+    std::string result;
+    size_t lineStart = request.find("\r\n");
+    while (lineStart != std::string::npos) {
+        lineStart += 2;
+        size_t lineEnd = request.find("\r\n", lineStart);
+        if (lineEnd == std::string::npos || lineEnd == lineStart) {
+            break;
+        }
+        size_t colon = request.find(':', lineStart);
+        if (colon != std::string::npos && colon < lineEnd && colon - lineStart == name.size()
+            && std::equal(name.begin(), name.end(), request.begin() + lineStart, [](char a, char b) {
+                   return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+               })) {
+            size_t valueStart = request.find_first_not_of(" \t", colon + 1);
+            size_t valueEnd = request.find_last_not_of(" \t", lineEnd - 1);
+            if (valueStart != std::string::npos && valueStart < lineEnd) {
+                if (!result.empty()) {
+                    result += ", ";
+                }
+                result += request.substr(valueStart, valueEnd - valueStart + 1);
+            }
+        }
+        lineStart = lineEnd;
+    }
+    return result;
+}
+
+std::string computeAcceptKey(std::string_view clientKey) {
+    std::string combined;
+    combined.reserve(clientKey.size() + std::strlen(WS_GUID));
+    combined.append(clientKey).append(WS_GUID);
+    
+    unsigned char hash[20];
+    sha1(combined, hash);
+    
+    return base64Encode(hash, 20);
+}
+
+// 简单的 SHA1 实现
+void sha1(std::string_view input, unsigned char output[20]) {
+    uint32_t h0 = 0x67452301;
+    uint32_t h1 = 0xEFCDAB89;
+    uint32_t h2 = 0x98BADCFE;
+    uint32_t h3 = 0x10325476;
+    uint32_t h4 = 0xC3D2E1F0;
+
+    // 填充消息
+    std::vector<unsigned char> msg(input.begin(), input.end());
+    uint64_t originalBitLen = msg.size() * 8;
+    
+    msg.push_back(0x80);
+    while ((msg.size() % 64) != 56) {
+        msg.push_back(0x00);
+    }
+    
+    for (int i = 7; i >= 0; --i) {
+        msg.push_back(static_cast<unsigned char>((originalBitLen >> (i * 8)) & 0xFF));
+    }
+
+    // 处理每个 512 位块
+    for (size_t chunk = 0; chunk < msg.size(); chunk += 64) {
+        uint32_t w[80];
+        
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (static_cast<uint32_t>(msg[chunk + i * 4]) << 24) |
+                   (static_cast<uint32_t>(msg[chunk + i * 4 + 1]) << 16) |
+                   (static_cast<uint32_t>(msg[chunk + i * 4 + 2]) << 8) |
+                   (static_cast<uint32_t>(msg[chunk + i * 4 + 3]));
+        }
+        
+        for (int i = 16; i < 80; ++i) {
+            uint32_t temp = w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16];
+            w[i] = (temp << 1) | (temp >> 31);
+        }
+
+        uint32_t a = h0, b = h1, c = h2, d = h3, e = h4;
+
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | ((~b) & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+
+            uint32_t temp = ((a << 5) | (a >> 27)) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = (b << 30) | (b >> 2);
+            b = a;
+            a = temp;
+        }
+
+        h0 += a;
+        h1 += b;
+        h2 += c;
+        h3 += d;
+        h4 += e;
+    }
+
+    // 输出哈希值
+    output[0] = static_cast<unsigned char>((h0 >> 24) & 0xFF);
+    output[1] = static_cast<unsigned char>((h0 >> 16) & 0xFF);
+    output[2] = static_cast<unsigned char>((h0 >> 8) & 0xFF);
+    output[3] = static_cast<unsigned char>(h0 & 0xFF);
+    output[4] = static_cast<unsigned char>((h1 >> 24) & 0xFF);
+    output[5] = static_cast<unsigned char>((h1 >> 16) & 0xFF);
+    output[6] = static_cast<unsigned char>((h1 >> 8) & 0xFF);
+    output[7] = static_cast<unsigned char>(h1 & 0xFF);
+    output[8] = static_cast<unsigned char>((h2 >> 24) & 0xFF);
+    output[9] = static_cast<unsigned char>((h2 >> 16) & 0xFF);
+    output[10] = static_cast<unsigned char>((h2 >> 8) & 0xFF);
+    output[11] = static_cast<unsigned char>(h2 & 0xFF);
+    output[12] = static_cast<unsigned char>((h3 >> 24) & 0xFF);
+    output[13] = static_cast<unsigned char>((h3 >> 16) & 0xFF);
+    output[14] = static_cast<unsigned char>((h3 >> 8) & 0xFF);
+    output[15] = static_cast<unsigned char>(h3 & 0xFF);
+    output[16] = static_cast<unsigned char>((h4 >> 24) & 0xFF);
+    output[17] = static_cast<unsigned char>((h4 >> 16) & 0xFF);
+    output[18] = static_cast<unsigned char>((h4 >> 8) & 0xFF);
+    output[19] = static_cast<unsigned char>(h4 & 0xFF);
+}
+
+std::string base64Encode(const unsigned char* data, size_t length) {
+    static const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    
+    std::string result;
+    result.reserve(((length + 2) / 3) * 4);
+
+    for (size_t i = 0; i < length; i += 3) {
+        unsigned int n = static_cast<unsigned int>(data[i]) << 16;
+        if (i + 1 < length) n |= static_cast<unsigned int>(data[i + 1]) << 8;
+        if (i + 2 < length) n |= static_cast<unsigned int>(data[i + 2]);
+
+        result += chars[(n >> 18) & 0x3F];
+        result += chars[(n >> 12) & 0x3F];
+        result += (i + 1 < length) ? chars[(n >> 6) & 0x3F] : '=';
+        result += (i + 2 < length) ? chars[n & 0x3F] : '=';
+    }
+
+    return result;
+}
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace mclistener_ws_server {
+
+// WebSocket 握手用到的纯函数，不依赖 socket 或平台
+
+// 在请求头中查找指定字段 (不区分大小写)，多次出现的同名字段以 ", " 连接
+std::string getHeaderValue(const std::string& request, const std::string& name);
+
+// 计算 Sec-WebSocket-Accept: base64(SHA1(key + GUID))
+std::string computeAcceptKey(std::string_view clientKey);
+
+// SHA1 哈希
+void sha1(std::string_view input, unsigned char output[20]);
+
+// Base64 编码
+std::string base64Encode(const unsigned char* data, size_t length);
+
+} // namespace mclistener_ws_server
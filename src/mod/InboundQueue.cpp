@@ -0,0 +1,43 @@
+#include "mod/InboundQueue.h"
+
+#include <algorithm>
+
+namespace mclistener_ws_server {
+
+InboundQueue::InboundQueue(size_t capacity, size_t maxMessagesPerTick, std::chrono::microseconds maxTimePerTick)
+    : mQueue(std::max<size_t>(capacity, 2)),
+      mMaxMessagesPerTick(std::max<size_t>(maxMessagesPerTick, 1)),
+      mMaxTimePerTick(maxTimePerTick) {}
+
+bool InboundQueue::post(InboundMessage&& message) {
+    if (!mQueue.tryPush(std::move(message))) {
+        ++mDropped;
+        return false;
+    }
+    return true;
+}
+
+size_t InboundQueue::drain(const Handler& handler) {
+    if (mQueue.empty()) {
+        return 0;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + mMaxTimePerTick;
+    InboundMessage message;
+    size_t processed = 0;
+    while (processed < mMaxMessagesPerTick && mQueue.tryPop(message)) {
+        handler(message);
+        ++processed;
+        if (std::chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+    }
+
+    mProcessed += processed;
+    if (!mQueue.empty()) {
+        ++mDeferredTicks;
+    }
+    return processed;
+}
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "mod/MpscQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace mclistener_ws_server {
+
+/**
+ * 已在网络线程解析并格式化好的群消息
+ * 游戏线程只需把 formatted 发给玩家
+ */
+struct InboundMessage {
+    std::string groupName;
+    std::string nickname;
+    std::string content;
+    std::string formatted; // 按 groupMessageFormat 格式化后的游戏内文本
+    std::chrono::steady_clock::time_point receivedAt = std::chrono::steady_clock::now();
+};
+
+/**
+ * 网络线程到游戏线程的入站消息队列
+ * 事件循环线程解析完消息后 post() 入队，游戏线程在每个 tick 中调用 drain()，
+ * 每个 tick 处理的消息数和耗时都有上限，积压的消息留给之后的 tick，
+ * 因此入站消息洪水不会造成 tick 延迟尖峰
+ */
+class InboundQueue {
+public:
+    using Handler = std::function<void(InboundMessage& message)>;
+
+    InboundQueue(size_t capacity, size_t maxMessagesPerTick, std::chrono::microseconds maxTimePerTick);
+
+    // 禁止拷贝
+    InboundQueue(const InboundQueue&) = delete;
+    InboundQueue& operator=(const InboundQueue&) = delete;
+
+    // 提交消息 (任意线程，无锁)，队列满时丢弃并返回 false
+    bool post(InboundMessage&& message);
+
+    // 在游戏线程中按预算处理消息，返回处理的条数；至少处理一条以保证积压能被消化
+    size_t drain(const Handler& handler);
+
+    // 因队列满被丢弃的消息数
+    uint64_t getDroppedCount() const { return mDropped; }
+
+    // 已交给游戏线程处理的消息数
+    uint64_t getProcessedCount() const { return mProcessed; }
+
+    // 预算用尽时仍有消息积压的 tick 数
+    uint64_t getDeferredTickCount() const { return mDeferredTicks; }
+
+private:
+    MpscQueue<InboundMessage> mQueue;
+    size_t mMaxMessagesPerTick;
+    std::chrono::microseconds mMaxTimePerTick;
+
+    std::atomic<uint64_t> mDropped{0};
+    std::atomic<uint64_t> mProcessed{0};
+    std::atomic<uint64_t> mDeferredTicks{0};
+};
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,327 @@
+#include "mod/InboundScanner.h"
+#include "mod/JsonWriter.h"
+
+#include <cstdint>
+
+namespace mclistener_ws_server {
+
+// 不带指数的数字超过这个长度时交给完整解析 (可能溢出为 inf，nlohmann 会报错)
+static constexpr size_t MAX_NUMBER_LENGTH = 300;
+
+static bool isWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool readHex4(const char*& pos, const char* end, uint32_t& value) {
+    if (end - pos < 4) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < 4; ++i) {
+        int digit = hexValue(pos[i]);
+        if (digit < 0) {
+            return false;
+        }
+        value = (value << 4) | static_cast<uint32_t>(digit);
+    }
+    pos += 4;
+    return true;
+}
+
+static void appendUtf8(std::string& out, uint32_t codepoint) {
+    if (codepoint < 0x80) {
+        out.push_back(static_cast<char>(codepoint));
+    } else if (codepoint < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    } else if (codepoint < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    }
+}
+
+// mPos 指向开头的引号。没有转义时 value 直接指向输入，否则解码到 buffer
+bool InboundScanner::readString(std::string_view& value, std::string& buffer) {
+    const char* begin = ++mPos;
+    const auto* end = reinterpret_cast<const unsigned char*>(mEnd);
+
+    // 快速路径: 一直扫到结束引号或第一个转义
+    while (mPos < mEnd) {
+        auto c = static_cast<unsigned char>(*mPos);
+        if (c == '"') {
+            value = std::string_view(begin, static_cast<size_t>(mPos - begin));
+            ++mPos;
+            return true;
+        }
+        if (c == '\\') {
+            break;
+        }
+        if (c < 0x20) {
+            return false;
+        }
+        if (c >= 0x80) {
+            const auto* bytes = reinterpret_cast<const unsigned char*>(mPos);
+            size_t sequence = utf8SequenceLength(bytes, static_cast<size_t>(end - bytes), 0);
+            if (sequence == 0) {
+                return false;
+            }
+            mPos += sequence;
+            continue;
+        }
+        ++mPos;
+    }
+    if (mPos >= mEnd) {
+        return false;
+    }
+
+    // 慢速路径: 已扫过的部分原样复制，其余逐个解码
+    buffer.assign(begin, mPos);
+    while (mPos < mEnd) {
+        auto c = static_cast<unsigned char>(*mPos);
+        if (c == '"') {
+            value = buffer;
+            ++mPos;
+            return true;
+        }
+        if (c < 0x20) {
+            return false;
+        }
+        if (c >= 0x80) {
+            const auto* bytes = reinterpret_cast<const unsigned char*>(mPos);
+            size_t sequence = utf8SequenceLength(bytes, static_cast<size_t>(end - bytes), 0);
+            if (sequence == 0) {
+                return false;
+            }
+            buffer.append(mPos, sequence);
+            mPos += sequence;
+            continue;
+        }
+        if (c != '\\') {
+            buffer.push_back(static_cast<char>(c));
+            ++mPos;
+            continue;
+        }
+        if (++mPos >= mEnd) {
+            return false;
+        }
+        switch (*mPos++) {
+        case '"':  buffer.push_back('"'); break;
+        case '\\': buffer.push_back('\\'); break;
+        case '/':  buffer.push_back('/'); break;
+        case 'b':  buffer.push_back('\b'); break;
+        case 'f':  buffer.push_back('\f'); break;
+        case 'n':  buffer.push_back('\n'); break;
+        case 'r':  buffer.push_back('\r'); break;
+        case 't':  buffer.push_back('\t'); break;
+        case 'u': {
+            uint32_t codepoint;
+            if (!readHex4(mPos, mEnd, codepoint)) {
+                return false;
+            }
+            if (codepoint >= 0xDC00 && codepoint <= 0xDFFF) {
+                return false; // 单独的低代理项
+            }
+            if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+                // 高代理项后必须紧跟 \u 低代理项
+                uint32_t low;
+                if (mEnd - mPos < 2 || mPos[0] != '\\' || mPos[1] != 'u') {
+                    return false;
+                }
+                mPos += 2;
+                if (!readHex4(mPos, mEnd, low) || low < 0xDC00 || low > 0xDFFF) {
+                    return false;
+                }
+                codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+            }
+            appendUtf8(buffer, codepoint);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return false;
+}
+
+bool InboundScanner::skipNumber() {
+    const char* begin = mPos;
+    auto digit = [this] { return mPos < mEnd && *mPos >= '0' && *mPos <= '9'; };
+
+    if (*mPos == '-') {
+        ++mPos;
+    }
+    if (!digit()) {
+        return false;
+    }
+    if (*mPos == '0') {
+        ++mPos;
+    } else {
+        while (digit()) ++mPos;
+    }
+    if (mPos < mEnd && *mPos == '.') {
+        ++mPos;
+        if (!digit()) {
+            return false;
+        }
+        while (digit()) ++mPos;
+    }
+    // 指数可能使数值溢出，这类少见的输入交给完整解析
+    if (mPos < mEnd && (*mPos == 'e' || *mPos == 'E')) {
+        return false;
+    }
+    return static_cast<size_t>(mPos - begin) <= MAX_NUMBER_LENGTH;
+}
+
+bool InboundScanner::skipValue(int depth) {
+    if (mPos >= mEnd) {
+        return false;
+    }
+    std::string_view unused;
+    switch (*mPos) {
+    case '"':
+        return readString(unused, mScratch);
+    case 't':
+    case 'f':
+    case 'n': {
+        std::string_view rest(mPos, static_cast<size_t>(mEnd - mPos));
+        for (std::string_view literal : {"true", "false", "null"}) {
+            if (rest.starts_with(literal)) {
+                mPos += literal.size();
+                return true;
+            }
+        }
+        return false;
+    }
+    case '[':
+    case '{': {
+        if (depth >= MaxDepth) {
+            return false;
+        }
+        const bool object = *mPos == '{';
+        const char close = object ? '}' : ']';
+        ++mPos;
+        while (mPos < mEnd && isWhitespace(*mPos)) ++mPos;
+        if (mPos < mEnd && *mPos == close) {
+            ++mPos;
+            return true;
+        }
+        while (true) {
+            if (object) {
+                if (mPos >= mEnd || *mPos != '"' || !readString(unused, mScratch)) {
+                    return false;
+                }
+                while (mPos < mEnd && isWhitespace(*mPos)) ++mPos;
+                if (mPos >= mEnd || *mPos++ != ':') {
+                    return false;
+                }
+                while (mPos < mEnd && isWhitespace(*mPos)) ++mPos;
+            }
+            if (!skipValue(depth + 1)) {
+                return false;
+            }
+            while (mPos < mEnd && isWhitespace(*mPos)) ++mPos;
+            if (mPos >= mEnd) {
+                return false;
+            }
+            char c = *mPos++;
+            if (c == close) {
+                return true;
+            }
+            if (c != ',') {
+                return false;
+            }
+            while (mPos < mEnd && isWhitespace(*mPos)) ++mPos;
+        }
+    }
+    default:
+        return skipNumber();
+    }
+}
+
+bool InboundScanner::scan(std::string_view json, GroupMessageFields& fields) {
+    mPos = json.data();
+    mEnd = json.data() + json.size();
+
+    std::string_view* targets[FieldCount] = {
+        &fields.type, &fields.groupId, &fields.groupName, &fields.nickname, &fields.message, &fields.platform,
+    };
+    static constexpr std::string_view Keys[FieldCount] = {
+        "type", "group_id", "group_name", "nickname", "message", "platform",
+    };
+    unsigned found = 0;
+
+    auto skipWhitespace = [this] {
+        while (mPos < mEnd && isWhitespace(*mPos)) ++mPos;
+    };
+
+    skipWhitespace();
+    if (mPos >= mEnd || *mPos != '{') {
+        return false;
+    }
+    ++mPos;
+    skipWhitespace();
+    if (mPos < mEnd && *mPos == '}') {
+        ++mPos;
+    } else {
+        while (true) {
+            std::string_view key;
+            if (mPos >= mEnd || *mPos != '"' || !readString(key, mScratch)) {
+                return false;
+            }
+            // 键名含转义时 key 指向 mScratch，之后会被覆盖；这种情况很少见，直接交给完整解析
+            if (key.data() == mScratch.data()) {
+                return false;
+            }
+            skipWhitespace();
+            if (mPos >= mEnd || *mPos++ != ':') {
+                return false;
+            }
+            skipWhitespace();
+
+            size_t index = 0;
+            while (index < FieldCount && Keys[index] != key) {
+                ++index;
+            }
+            if (index < FieldCount) {
+                // 重复的键 (nlohmann 取最后一个) 和非字符串的值都交给完整解析
+                if ((found & (1u << index)) != 0 || mPos >= mEnd || *mPos != '"'
+                    || !readString(*targets[index], mUnescaped[index])) {
+                    return false;
+                }
+                found |= 1u << index;
+            } else if (!skipValue(0)) {
+                return false;
+            }
+
+            skipWhitespace();
+            if (mPos >= mEnd) {
+                return false;
+            }
+            char c = *mPos++;
+            if (c == '}') {
+                break;
+            }
+            if (c != ',') {
+                return false;
+            }
+            skipWhitespace();
+        }
+    }
+    skipWhitespace();
+    return mPos == mEnd;
+}
+
+} // namespace mclistener_ws_server
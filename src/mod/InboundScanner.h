@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace mclistener_ws_server {
+
+// 入站消息中由消息回调读取的字段，均为顶层字符串字段
+// 所有字段都有默认值，可以只用指派初始化给出缺省值不同的字段，如 {.nickname = "..."}
+struct GroupMessageFields {
+    std::string_view type = {};
+    std::string_view groupId = {};
+    std::string_view groupName = {};
+    std::string_view nickname = {};
+    std::string_view message = {};
+    std::string_view platform = {};
+};
+
+/**
+ * 入站 JSON 群消息的单遍扫描器
+ *
+ * 不构造 nlohmann::json，一次遍历取出 GroupMessageFields 中的顶层字符串字段，
+ * 结果直接指向接收缓冲区，只有含转义的值才解码到扫描器内部的缓冲区 (容量跨调用复用，稳定后不再分配)。
+ * 其余字段只校验语法后跳过，因此只有 nlohmann::json::parse() 也会接受的输入才会扫描成功。
+ *
+ * 扫描器不处理的情况 (语法错误、字段不是字符串、重复的字段、键名含转义、带指数的数字、
+ * 嵌套过深等) scan() 返回 false，调用方应退回完整解析，错误信息和行为与之前相同
+ */
+class InboundScanner {
+public:
+    // 扫描一条 JSON 文本，只覆盖找到的字段 (调用方预先填好缺省值)
+    // 返回 true 时 fields 中的值在下次 scan() 之前和 json 的生命周期内有效；返回 false 时 fields 可能已被部分覆盖
+    bool scan(std::string_view json, GroupMessageFields& fields);
+
+private:
+    static constexpr size_t FieldCount = 6;
+    static constexpr int MaxDepth = 32;
+
+    bool readString(std::string_view& value, std::string& buffer);
+    bool skipValue(int depth);
+    bool skipNumber();
+
+    const char* mPos = nullptr;
+    const char* mEnd = nullptr;
+
+    // 含转义的字段值解码到这里，每个字段一个，互不影响
+    std::array<std::string, FieldCount> mUnescaped;
+    // 跳过的字符串的解码结果 (只用于校验)
+    std::string mScratch;
+};
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,81 @@
+#include "mod/JsonWriter.h"
+
+namespace mclistener_ws_server {
+
+size_t utf8SequenceLength(const unsigned char* data, size_t length, size_t i) {
+    auto continuation = [&](size_t offset, unsigned char low = 0x80, unsigned char high = 0xBF) {
+        return i + offset < length && data[i + offset] >= low && data[i + offset] <= high;
+    };
+
+    unsigned char lead = data[i];
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        return continuation(1) ? 2 : 0;
+    }
+    if (lead >= 0xE0 && lead <= 0xEF) {
+        // 排除过长编码 (E0 80..9F) 和代理项 (ED A0..BF)
+        unsigned char low = lead == 0xE0 ? 0xA0 : 0x80;
+        unsigned char high = lead == 0xED ? 0x9F : 0xBF;
+        return continuation(1, low, high) && continuation(2) ? 3 : 0;
+    }
+    if (lead >= 0xF0 && lead <= 0xF4) {
+        // 排除过长编码 (F0 80..8F) 和超出 U+10FFFF 的码点 (F4 90..BF)
+        unsigned char low = lead == 0xF0 ? 0x90 : 0x80;
+        unsigned char high = lead == 0xF4 ? 0x8F : 0xBF;
+        return continuation(1, low, high) && continuation(2) && continuation(3) ? 4 : 0;
+    }
+    return 0;
+}
+
+bool appendJsonString(std::string& out, std::string_view value) {
+    const auto* data = reinterpret_cast<const unsigned char*>(value.data());
+    const size_t length = value.size();
+
+    // 快速路径: 找到第一个需要转义或非 ASCII 的字节，之前的部分整段追加
+    size_t plain = 0;
+    while (plain < length && data[plain] >= 0x20 && data[plain] < 0x80 && data[plain] != '"' && data[plain] != '\\') {
+        ++plain;
+    }
+    out.push_back('"');
+    out.append(value.data(), plain);
+    if (plain == length) {
+        out.push_back('"');
+        return true;
+    }
+
+    static constexpr char Hex[] = "0123456789abcdef";
+    for (size_t i = plain; i < length;) {
+        unsigned char c = data[i];
+        if (c >= 0x80) {
+            // 多字节字符原样写出 (dump() 默认不转义为 \uXXXX)
+            size_t sequence = utf8SequenceLength(data, length, i);
+            if (sequence == 0) {
+                return false;
+            }
+            out.append(value.data() + i, sequence);
+            i += sequence;
+            continue;
+        }
+        switch (c) {
+        case '"':  out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\b': out.append("\\b"); break;
+        case '\f': out.append("\\f"); break;
+        case '\n': out.append("\\n"); break;
+        case '\r': out.append("\\r"); break;
+        case '\t': out.append("\\t"); break;
+        default:
+            if (c < 0x20) {
+                char escaped[6] = {'\\', 'u', '0', '0', Hex[c >> 4], Hex[c & 0xF]};
+                out.append(escaped, sizeof(escaped));
+            } else {
+                out.push_back(static_cast<char>(c));
+            }
+            break;
+        }
+        ++i;
+    }
+    out.push_back('"');
+    return true;
+}
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace mclistener_ws_server {
+
+// 从 data[i] 开始的 UTF-8 序列长度，不合法时返回 0 (接受的范围与 nlohmann 的 UTF-8 校验相同)
+size_t utf8SequenceLength(const unsigned char* data, size_t length, size_t i);
+
+// 把字符串按 JSON 规则转义后加上引号追加到 out，转义方式与 nlohmann::json::dump() 相同
+// 纯 ASCII 且无需转义的字符串直接整段追加；返回 false 表示不是合法 UTF-8 (dump() 会拒绝序列化)
+bool appendJsonString(std::string& out, std::string_view value);
+
+/**
+ * 编译期生成的键片段 `,"key":`
+ * 作为模板参数使用，例如 writer.string<"player_name">(name)，键名和标点在编译期拼好，运行时只追加一段内存
+ */
+template <size_t N>
+struct JsonKey {
+    char text[N + 3] = {};
+    static constexpr size_t size = N + 3;
+
+    consteval JsonKey(const char (&key)[N]) {
+        text[0] = ',';
+        text[1] = '"';
+        for (size_t i = 0; i + 1 < N; ++i) {
+            // 键名原样写出，不能含有需要转义的字符
+            if (key[i] < 0x20 || key[i] == '"' || key[i] == '\\') {
+                throw "JSON key must not need escaping";
+            }
+            text[2 + i] = key[i];
+        }
+        text[N + 1] = '"';
+        text[N + 2] = ':';
+    }
+};
+
+/**
+ * 固定结构的 JSON 对象写入器
+ * 出站事件的结构是固定的，不必先构造 nlohmann::json 再 dump()。
+ * 调用方需按键的字典序写入字段 (nlohmann::json 的对象按 std::map 排序)，输出才与 dump() 逐字节相同
+ */
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : mOut(out) { mOut.push_back('{'); }
+
+    template <JsonKey Key>
+    void string(std::string_view value) {
+        key<Key>();
+        mValid = appendJsonString(mOut, value) && mValid;
+    }
+
+    template <JsonKey Key>
+    void number(uint64_t value) {
+        key<Key>();
+        char digits[20];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        mOut.append(digits, result.ptr);
+    }
+
+    template <JsonKey Key>
+    void boolean(bool value) {
+        key<Key>();
+        mOut.append(value ? "true" : "false");
+    }
+
+    // 结束对象，返回 false 表示写入过不合法的 UTF-8 字符串，输出不可用
+    bool finish() {
+        mOut.push_back('}');
+        return mValid;
+    }
+
+private:
+    template <JsonKey Key>
+    void key() {
+        // 第一个字段前没有逗号
+        size_t skip = mFirst ? 1 : 0;
+        mOut.append(Key.text + skip, Key.size - skip);
+        mFirst = false;
+    }
+
+    std::string& mOut;
+    bool mFirst = true;
+    bool mValid = true;
+};
+
+} // namespace mclistener_ws_server
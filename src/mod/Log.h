@@ -0,0 +1,100 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace mclistener_ws_server {
+
+// 日志级别，数值越大越详细 (顺序与 ll::io::LogLevel 一致)
+enum class LogLevel : int8_t {
+    Off = -1,
+    Fatal,
+    Error,
+    Warn,
+    Info,
+    Debug,
+    Trace,
+};
+
+// 当前生效的日志级别，加载配置时与 logger 的级别同步设置
+inline std::atomic<int8_t> gActiveLogLevel{static_cast<int8_t>(LogLevel::Info)};
+
+inline void setActiveLogLevel(LogLevel level) {
+    gActiveLogLevel.store(static_cast<int8_t>(level), std::memory_order_relaxed);
+}
+
+// 该级别的日志是否会被输出
+inline bool shouldLog(LogLevel level) {
+    return static_cast<int8_t>(level) <= gActiveLogLevel.load(std::memory_order_relaxed);
+}
+
+/**
+ * 核心代码 (WebSocketServer、EventDispatcher 等) 使用的日志接口
+ * 插件中转发给 LeviLamina 的 logger，基准测试和压测工具中输出到 stderr，
+ * 因此核心代码不依赖 LeviLamina，可以在 Linux 上编译运行
+ *
+ * 低于当前级别的日志不会格式化
+ */
+class Logger {
+public:
+    virtual ~Logger() = default;
+
+    template <typename... Args>
+    void log(LogLevel level, fmt::format_string<Args...> format, Args&&... args) {
+        if (shouldLog(level)) {
+            write(level, fmt::format(format, std::forward<Args>(args)...));
+        }
+    }
+
+    template <typename... Args>
+    void trace(fmt::format_string<Args...> format, Args&&... args) {
+        log(LogLevel::Trace, format, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    void debug(fmt::format_string<Args...> format, Args&&... args) {
+        log(LogLevel::Debug, format, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    void info(fmt::format_string<Args...> format, Args&&... args) {
+        log(LogLevel::Info, format, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    void warn(fmt::format_string<Args...> format, Args&&... args) {
+        log(LogLevel::Warn, format, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    void error(fmt::format_string<Args...> format, Args&&... args) {
+        log(LogLevel::Error, format, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    void fatal(fmt::format_string<Args...> format, Args&&... args) {
+        log(LogLevel::Fatal, format, std::forward<Args>(args)...);
+    }
+
+protected:
+    // 输出一条已格式化的日志
+    virtual void write(LogLevel level, const std::string& text) = 0;
+};
+
+} // namespace mclistener_ws_server
+
+// 热路径上的日志: 先比较级别，低于当前级别时参数既不求值也不格式化
+// 用法: MCWS_TRACE(mLogger, "Broadcasting to {} clients", count);
+#define MCWS_LOG_IF(level, logger, method, ...)                                                                   \
+    do {                                                                                                          \
+        if (::mclistener_ws_server::shouldLog(::mclistener_ws_server::LogLevel::level)) {                         \
+            (logger).method(__VA_ARGS__);                                                                         \
+        }                                                                                                         \
+    } while (0)
+
+#define MCWS_TRACE(logger, ...) MCWS_LOG_IF(Trace, logger, trace, __VA_ARGS__)
+#define MCWS_DEBUG(logger, ...) MCWS_LOG_IF(Debug, logger, debug, __VA_ARGS__)
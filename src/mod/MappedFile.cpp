@@ -0,0 +1,104 @@
+#include "mod/MappedFile.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace mclistener_ws_server {
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::filesystem::path& path, size_t size) {
+    close();
+    if (size == 0) {
+        return false;
+    }
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER length;
+    length.QuadPart = static_cast<LONGLONG>(size);
+    if (!SetFilePointerEx(file, length, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32),
+                                        static_cast<DWORD>(size & 0xFFFFFFFF), nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!data) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    mFile = file;
+    mMapping = mapping;
+#else
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+    mFd = fd;
+#endif
+
+    mData = static_cast<unsigned char*>(data);
+    mSize = size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (!mData) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(mData);
+    CloseHandle(mMapping);
+    CloseHandle(mFile);
+    mMapping = nullptr;
+    mFile = nullptr;
+#else
+    munmap(mData, mSize);
+    ::close(mFd);
+    mFd = -1;
+#endif
+    mData = nullptr;
+    mSize = 0;
+}
+
+void MappedFile::flush() {
+    if (!mData) {
+        return;
+    }
+#ifdef _WIN32
+    FlushViewOfFile(mData, 0);
+#else
+    msync(mData, mSize, MS_ASYNC);
+#endif
+}
+
+} // namespace mclistener_ws_server
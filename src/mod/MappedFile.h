@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+namespace mclistener_ws_server {
+
+/**
+ * 固定大小的可读写内存映射文件
+ * Windows 下为 CreateFileMapping / MapViewOfFile，其他平台为 mmap
+ * 写入映射区域就是写入文件，由操作系统负责回写，进程崩溃不会丢失已写入的数据
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // 打开 (不存在时创建) 文件并映射，文件大小与 size 不同时会被扩展或截断
+    bool open(const std::filesystem::path& path, size_t size);
+
+    // 取消映射并关闭文件
+    void close();
+
+    // 异步回写脏页 (不等待完成)
+    void flush();
+
+    bool isOpen() const { return mData != nullptr; }
+    unsigned char* data() const { return mData; }
+    size_t size() const { return mSize; }
+
+private:
+    unsigned char* mData = nullptr;
+    size_t mSize = 0;
+#ifdef _WIN32
+    void* mFile = nullptr;
+    void* mMapping = nullptr;
+#else
+    int mFd = -1;
+#endif
+};
+
+} // namespace mclistener_ws_server
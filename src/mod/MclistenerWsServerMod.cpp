@@ -1,4 +1,9 @@
 #include "mod/MclistenerWsServerMod.h"
+#include "mod/EventDispatcher.h"
+#include "mod/EventJournal.h"
+#include "mod/InboundQueue.h"
+#include "mod/InboundScanner.h"
+#include "mod/Telemetry.h"
 #include "mod/WebSocketServer.h"
 
 #include "ll/api/mod/RegisterHelper.h"
@@ -9,6 +14,7 @@
 #include "ll/api/event/player/PlayerChatEvent.h"
 #include "ll/api/service/Bedrock.h"
 #include "ll/api/io/LogLevel.h"
+#include "ll/api/io/Logger.h"
 #include "ll/api/memory/Hook.h"
 
 #include "mc/world/actor/player/Player.h"
@@ -19,7 +25,11 @@
 
 #include <nlohmann/json.hpp>
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
 
 namespace mclistener_ws_server {
 
@@ -27,6 +37,30 @@ namespace mclistener_ws_server {
 static MclistenerWsServerMod* g_modInstance = nullptr;
 static bool hookEnabled = false;
 
+// 异步日志队列容量，突发聊天时足够缓冲数秒的日志
+static constexpr size_t ASYNC_LOG_QUEUE_CAPACITY = 4096;
+
+// 服务器 tick 计数，只由游戏线程递增
+static std::atomic<uint64_t> g_serverTick{0};
+
+// Hook Level::tick 用于维护 tick 计数
+LL_TYPE_INSTANCE_HOOK(
+    LevelTickHook,
+    ll::memory::HookPriority::Normal,
+    Level,
+    &Level::$tick,
+    void
+) {
+    uint64_t tick = g_serverTick.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (g_modInstance) {
+        g_modInstance->processInboundMessages();
+        g_modInstance->sampleTelemetry(tick);
+    }
+    origin();
+}
+
+static ll::memory::HookRegistrar<LevelTickHook> levelTickHookRegistrar;
+
 // Hook TextPacket 处理函数
 // 使用 High 优先级，在 LeviLamina 的 PlayerChatEvent hook (Normal=200) 之前执行
 // 这样即使 GwChat 取消了 PlayerChatEvent，我们也能捕获到消息
@@ -55,20 +89,19 @@ LL_TYPE_INSTANCE_HOOK(
                     return;
                 }
                 
-                g_modInstance->getSelf().getLogger().trace("TextPacketHook triggered (High priority, before event system)");
-                g_modInstance->getSelf().getLogger().debug("[Hook] {} said: {}", playerName, msg);
-                
-                nlohmann::json jsonMsg;
-                jsonMsg["type"] = "player_msg";
-                jsonMsg["player_name"] = playerName;
-                jsonMsg["content"] = msg;
+                MCWS_TRACE(g_modInstance->getSelf().getLogger(), "TextPacketHook triggered (High priority, before event system)");
+                MCWS_DEBUG(g_modInstance->getSelf().getLogger(), "[Hook] {} said: {}", playerName, msg);
+                g_modInstance->logInfo("[Server->WS][Hook] Chat from {}: {}", playerName, msg);
                 
-                std::string jsonStr = jsonMsg.dump();
-                g_modInstance->getSelf().getLogger().trace("Broadcasting JSON via hook: {}", jsonStr);
-                
-                if (auto* ws = g_modInstance->getWebSocketServer()) {
-                    ws->broadcast(jsonStr);
-                    g_modInstance->getSelf().getLogger().info("[Server->WS][Hook] Chat from {}: {}", playerName, msg);
+                // 只入队，序列化和广播由工作线程完成
+                if (auto* dispatcher = g_modInstance->getEventDispatcher()) {
+                    dispatcher->post(OutboundEvent{
+                        EventType::PlayerChat,
+                        CaptureSource::PacketHook,
+                        MclistenerWsServerMod::getCurrentTick(),
+                        std::move(playerName),
+                        std::move(msg)
+                    });
                 }
             }
         } catch (const std::exception& e) {
@@ -85,6 +118,20 @@ LL_TYPE_INSTANCE_HOOK(
 // Hook 注册器
 static ll::memory::HookRegistrar<TextPacketHook> textPacketHookRegistrar;
 
+// 当前本地时间，格式为 HH:MM:SS
+static std::string formatLocalTime() {
+    std::time_t now = std::time(nullptr);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    char buffer[16];
+    size_t length = std::strftime(buffer, sizeof(buffer), "%H:%M:%S", &local);
+    return std::string(buffer, length);
+}
+
 // 将字符串转换为日志级别
 static ll::io::LogLevel parseLogLevel(const std::string& levelStr) {
     std::string lower = levelStr;
@@ -102,6 +149,139 @@ static ll::io::LogLevel parseLogLevel(const std::string& levelStr) {
     return ll::io::LogLevel::Info; // 默认 info
 }
 
+// 按级别输出到插件的 logger
+static void writeLog(ll::io::Logger& logger, LogLevel level, const std::string& text) {
+    switch (level) {
+    case LogLevel::Fatal: logger.fatal("{}", text); break;
+    case LogLevel::Error: logger.error("{}", text); break;
+    case LogLevel::Warn:  logger.warn("{}", text); break;
+    case LogLevel::Debug: logger.debug("{}", text); break;
+    case LogLevel::Trace: logger.trace("{}", text); break;
+    default:              logger.info("{}", text); break;
+    }
+}
+
+// 把核心代码的日志转发给插件的 logger
+class ModLogger : public Logger {
+public:
+    explicit ModLogger(ll::io::Logger& logger) : mLogger(logger) {}
+
+protected:
+    void write(LogLevel level, const std::string& text) override { writeLog(mLogger, level, text); }
+
+private:
+    ll::io::Logger& mLogger;
+};
+
+// 与 logger 级别对应的内部级别，供热路径上的日志宏判断
+static LogLevel toLogLevel(ll::io::LogLevel level) {
+    switch (level) {
+    case ll::io::LogLevel::Off:   return LogLevel::Off;
+    case ll::io::LogLevel::Fatal: return LogLevel::Fatal;
+    case ll::io::LogLevel::Error: return LogLevel::Error;
+    case ll::io::LogLevel::Warn:  return LogLevel::Warn;
+    case ll::io::LogLevel::Info:  return LogLevel::Info;
+    case ll::io::LogLevel::Debug: return LogLevel::Debug;
+    default:                      return LogLevel::Trace;
+    }
+}
+
+uint64_t MclistenerWsServerMod::getCurrentTick() {
+    return g_serverTick.load(std::memory_order_relaxed);
+}
+
+void MclistenerWsServerMod::processInboundMessages() {
+    if (!mInboundQueue) {
+        return;
+    }
+
+    auto level = ll::service::getLevel();
+    Metrics* metrics = mWsServer ? &mWsServer->getMetrics() : nullptr;
+    mInboundQueue->drain([this, &level, metrics](InboundMessage& message) {
+        // 在游戏中广播消息: 只构造并序列化一个 TextPacket，通过广播发送路径发给所有客户端，
+        // 而不是对每个玩家调用 sendMessage 各自构造一次
+        if (level) {
+            TextPacket packet = TextPacket::createRawMessage(message.formatted);
+            packet.sendToClients();
+            MCWS_DEBUG(getSelf().getLogger(), "Broadcasted group message to all players in-game");
+        } else {
+            getSelf().getLogger().warn("Level not available, cannot broadcast message");
+        }
+
+        logInfo("[Group->Server] [{}] {}: {}", message.groupName, message.nickname, message.content);
+        if (metrics) {
+            metrics->inboundLatency.observe(std::chrono::steady_clock::now() - message.receivedAt);
+        }
+    });
+}
+
+void MclistenerWsServerMod::handleGroupMessage(const GroupMessageFields& fields) {
+    MCWS_DEBUG(getSelf().getLogger(), "Parsed message type: {}", fields.type);
+    if (fields.type != "group_to_server") {
+        MCWS_DEBUG(getSelf().getLogger(), "Ignoring message with type: {}", fields.type);
+        return;
+    }
+
+    mWsServer->getMetrics().inboundReceived.add();
+    MCWS_DEBUG(getSelf().getLogger(), "Group message details - group: {} ({}), user: {}",
+               fields.groupName, fields.groupId, fields.nickname);
+
+    // 使用预编译的消息格式，一次渲染，替换进来的内容不会被再次展开
+    std::string timestamp;
+    if (mGroupMessageTemplate.uses(MessageTemplate::Field::Timestamp)) {
+        timestamp = formatLocalTime();
+    }
+    std::string formattedMsg = mGroupMessageTemplate.render({
+        fields.groupId, fields.groupName, fields.nickname, fields.message, timestamp, fields.platform
+    });
+
+    MCWS_TRACE(getSelf().getLogger(), "Formatted message: {}", formattedMsg);
+
+    // 当前是网络线程，只入队，由游戏线程在 tick 中发给玩家
+    if (!mInboundQueue->post(InboundMessage{
+            std::string(fields.groupName),
+            std::string(fields.nickname),
+            std::string(fields.message),
+            std::move(formattedMsg)
+        })) {
+        mWsServer->getMetrics().inboundDropped.add();
+        MCWS_DEBUG(getSelf().getLogger(), "Inbound queue full, dropping group message ({} dropped in total)",
+                   mInboundQueue->getDroppedCount());
+    }
+}
+
+void MclistenerWsServerMod::sampleTelemetry(uint64_t tick) {
+    if (!mConfig.enableTelemetry || !mEventDispatcher || !mWsServer
+        || tick % static_cast<uint64_t>(std::max(mConfig.telemetryIntervalTicks, 1)) != 0) {
+        return;
+    }
+    // 没有客户端订阅时不采样
+    if (!mWsServer->hasSubscribers(EventType::Telemetry)) {
+        return;
+    }
+    auto level = ll::service::getLevel();
+    if (!level) {
+        return;
+    }
+
+    // 游戏线程只读取字段并量化，比较和编码由分发线程完成
+    auto snapshot = std::make_shared<TelemetrySnapshot>();
+    snapshot->tick = tick;
+    snapshot->reserve(mLastTelemetryPlayers);
+    level->forEachPlayer([&snapshot](Player& player) {
+        const Vec3& pos = player.getPosition();
+        snapshot->add(player.getRealName(), pos.x, pos.y, pos.z, player.getDimensionId().id, player.getHealth());
+        return true;
+    });
+    mLastTelemetryPlayers = snapshot->size();
+
+    OutboundEvent event;
+    event.type = EventType::Telemetry;
+    event.tick = tick;
+    event.telemetry = std::move(snapshot);
+    mEventDispatcher->post(std::move(event));
+}
+
 MclistenerWsServerMod& MclistenerWsServerMod::getInstance() {
     static MclistenerWsServerMod instance;
     return instance;
@@ -140,17 +320,55 @@ bool MclistenerWsServerMod::load() {
     // 设置日志级别
     ll::io::LogLevel logLevel = parseLogLevel(mConfig.logLevel);
     logger.setLevel(logLevel);
+    setActiveLogLevel(toLogLevel(logLevel));
     logger.info("Log level set to: {}", std::string(mConfig.logLevel));
 
     // 输出配置信息 (debug 级别)
     logger.debug("Configuration loaded:");
+    logger.debug("  - enableAsyncLogging: {}", mConfig.enableAsyncLogging);
     logger.debug("  - host: {}", std::string(mConfig.host));
     logger.debug("  - port: {}", mConfig.port);
+    logger.debug("  - localSocketPath: {}", std::string(mConfig.localSocketPath));
+    logger.debug("  - sendQueueCapacity: {}", mConfig.sendQueueCapacity);
+    logger.debug("  - sendQueueOverflowPolicy: {}", std::string(mConfig.sendQueueOverflowPolicy));
+    logger.debug("  - eventQueueCapacity: {}", mConfig.eventQueueCapacity);
+    logger.debug("  - enableBatching: {}", mConfig.enableBatching);
+    logger.debug("  - batchFlushIntervalMs: {}", mConfig.batchFlushIntervalMs);
+    logger.debug("  - batchMaxEvents: {}", mConfig.batchMaxEvents);
+    logger.debug("  - batchFormat: {}", std::string(mConfig.batchFormat));
+    logger.debug("  - enablePerMessageDeflate: {}", mConfig.enablePerMessageDeflate);
+    logger.debug("  - deflateMinPayloadSize: {}", mConfig.deflateMinPayloadSize);
+    logger.debug("  - deflateClientNoContextTakeover: {}", mConfig.deflateClientNoContextTakeover);
+    logger.debug("  - enableMsgPackProtocol: {}", mConfig.enableMsgPackProtocol);
+    logger.debug("  - pingIntervalMs: {}", mConfig.pingIntervalMs);
+    logger.debug("  - pongTimeoutMs: {}", mConfig.pongTimeoutMs);
+    logger.debug("  - idleTimeoutMs: {}", mConfig.idleTimeoutMs);
+    logger.debug("  - handshakeTimeoutMs: {}", mConfig.handshakeTimeoutMs);
+    logger.debug("  - slowConsumerQueueThreshold: {}", mConfig.slowConsumerQueueThreshold);
+    logger.debug("  - slowConsumerMaxBytes: {}", mConfig.slowConsumerMaxBytes);
+    logger.debug("  - slowConsumerTimeoutMs: {}", mConfig.slowConsumerTimeoutMs);
+    logger.debug("  - enableMetricsEndpoint: {}", mConfig.enableMetricsEndpoint);
+    logger.debug("  - metricsAllowRemote: {}", mConfig.metricsAllowRemote);
+    logger.debug("  - enableEventJournal: {}", mConfig.enableEventJournal);
+    logger.debug("  - journalRetentionMB: {}", mConfig.journalRetentionMB);
+    logger.debug("  - enableTelemetry: {}", mConfig.enableTelemetry);
+    logger.debug("  - telemetryIntervalTicks: {}", mConfig.telemetryIntervalTicks);
+    logger.debug("  - telemetryKeyframeInterval: {}", mConfig.telemetryKeyframeInterval);
     logger.debug("  - enablePlayerJoinBroadcast: {}", mConfig.enablePlayerJoinBroadcast);
     logger.debug("  - enablePlayerLeaveBroadcast: {}", mConfig.enablePlayerLeaveBroadcast);
     logger.debug("  - enablePlayerChatBroadcast: {}", mConfig.enablePlayerChatBroadcast);
     logger.debug("  - enableReceiveGroupMessage: {}", mConfig.enableReceiveGroupMessage);
+    logger.debug("  - inboundQueueCapacity: {}", mConfig.inboundQueueCapacity);
+    logger.debug("  - inboundMaxMessagesPerTick: {}", mConfig.inboundMaxMessagesPerTick);
+    logger.debug("  - inboundMaxMicrosPerTick: {}", mConfig.inboundMaxMicrosPerTick);
     logger.debug("  - chatCaptureMode: {}", std::string(mConfig.chatCaptureMode));
+    logger.debug("  - playerChatRateLimit: {}", mConfig.playerChatRateLimit);
+    logger.debug("  - playerChatBurst: {}", mConfig.playerChatBurst);
+    logger.debug("  - clientMessageRateLimit: {}", mConfig.clientMessageRateLimit);
+    logger.debug("  - clientMessageBurst: {}", mConfig.clientMessageBurst);
+
+    // 预编译群消息格式
+    mGroupMessageTemplate = MessageTemplate::compile(mConfig.groupMessageFormat);
 
     logger.info("mclistener-ws-server loaded successfully!");
     return true;
@@ -160,76 +378,77 @@ bool MclistenerWsServerMod::enable() {
     getSelf().getLogger().info("Enabling mclistener-ws-server...");
     getSelf().getLogger().debug("Creating WebSocket server instance...");
 
+    // 先启动异步日志，之后事件处理函数中的 info 日志都经由日志线程输出
+    if (mConfig.enableAsyncLogging) {
+        mLogSink = std::make_unique<AsyncLogSink>(ASYNC_LOG_QUEUE_CAPACITY, [this](LogLevel level, const std::string& text) {
+            writeLog(getSelf().getLogger(), level, text);
+        });
+        mLogSink->start();
+        getSelf().getLogger().debug("Async logging enabled (queue capacity: {})", ASYNC_LOG_QUEUE_CAPACITY);
+    }
+
     // 创建并启动 WebSocket 服务器
-    mWsServer = std::make_unique<WebSocketServer>(mConfig.host, mConfig.port, this);
-    
-    getSelf().getLogger().debug("Starting WebSocket server on {}:{}...", std::string(mConfig.host), mConfig.port);
-    if (!mWsServer->start()) {
-        getSelf().getLogger().error("Failed to start WebSocket server!");
-        getSelf().getLogger().fatal("Plugin cannot function without WebSocket server!");
-        return false;
+    mCoreLogger = std::make_unique<ModLogger>(getSelf().getLogger());
+
+    // 打开事件日志，失败时不影响广播，只是无法 resume
+    if (mConfig.enableEventJournal) {
+        size_t retention = static_cast<size_t>(std::max(mConfig.journalRetentionMB, 1)) * 1024 * 1024;
+        mJournal = std::make_unique<EventJournal>(getSelf().getDataDir() / "journal", retention, *mCoreLogger);
+        if (!mJournal->open()) {
+            getSelf().getLogger().error("Failed to open event journal, resume will be unavailable");
+            mJournal.reset();
+        }
     }
 
+    mWsServer = std::make_unique<WebSocketServer>(mConfig.host, mConfig.port, mConfig, *mCoreLogger);
+    mWsServer->setJournal(mJournal.get());
+    if (!mConfig.localSocketPath.empty()) {
+        // 绝对路径原样使用
+        mWsServer->setLocalSocketPath((getSelf().getDataDir() / mConfig.localSocketPath).string());
+    }
+    
     // 设置消息回调 - 处理从聊天平台来的消息
+    // 回调在事件循环线程中调用，必须在 start() 启动该线程之前设置好
     if (mConfig.enableReceiveGroupMessage) {
+        mInboundQueue = std::make_unique<InboundQueue>(
+            static_cast<size_t>(std::max(mConfig.inboundQueueCapacity, 2)),
+            static_cast<size_t>(std::max(mConfig.inboundMaxMessagesPerTick, 1)),
+            std::chrono::microseconds(std::max(mConfig.inboundMaxMicrosPerTick, 0))
+        );
+
         getSelf().getLogger().debug("Setting up message callback for group messages...");
-        mWsServer->setMessageCallback([this](const std::string& message) {
-            getSelf().getLogger().trace("Raw message received: {}", message);
+        mWsServer->setMessageCallback([this](const std::string& message, MessageEncoding encoding) {
+            bool binary = encoding == MessageEncoding::MsgPack;
+            if (!binary) {
+                MCWS_TRACE(getSelf().getLogger(), "Raw message received: {}", message);
+            }
             try {
-                auto json = nlohmann::json::parse(message);
+                // 常见的 JSON 群消息单遍扫描取出字段，不构造 DOM；
+                // MessagePack 和扫描器不处理的输入 (包括不合法的 JSON) 退回完整解析，报错与之前相同
+                thread_local InboundScanner scanner;
+                GroupMessageFields fields{.nickname = "未知用户"};
+                if (!binary && scanner.scan(message, fields)) {
+                    handleGroupMessage(fields);
+                    return;
+                }
+
+                auto json = binary ? nlohmann::json::from_msgpack(message) : nlohmann::json::parse(message);
                 std::string type = json.value("type", "");
-                getSelf().getLogger().debug("Parsed message type: {}", type);
-                
-                if (type == "group_to_server") {
-                    std::string groupId = json.value("group_id", "");
-                    std::string groupName = json.value("group_name", "");
-                    std::string nickname = json.value("nickname", "未知用户");
-                    std::string content = json.value("message", "");
-
-                    getSelf().getLogger().debug("Group message details - group: {} ({}), user: {}", 
-                                                 groupName, groupId, nickname);
-
-                    // 使用配置的消息格式
-                    std::string formattedMsg = mConfig.groupMessageFormat;
-                    
-                    // 替换占位符
-                    size_t pos;
-                    while ((pos = formattedMsg.find("{group_id}")) != std::string::npos) {
-                        formattedMsg.replace(pos, 10, groupId);
-                    }
-                    while ((pos = formattedMsg.find("{group_name}")) != std::string::npos) {
-                        formattedMsg.replace(pos, 12, groupName);
-                    }
-                    while ((pos = formattedMsg.find("{nickname}")) != std::string::npos) {
-                        formattedMsg.replace(pos, 10, nickname);
-                    }
-                    while ((pos = formattedMsg.find("{message}")) != std::string::npos) {
-                        formattedMsg.replace(pos, 9, content);
-                    }
-
-                    getSelf().getLogger().trace("Formatted message: {}", formattedMsg);
-
-                    // 在游戏中广播消息
-                    auto level = ll::service::getLevel();
-                    if (level) {
-                        int playerCount = 0;
-                        level->forEachPlayer([&formattedMsg, &playerCount](Player& player) -> bool {
-                            player.sendMessage(formattedMsg);
-                            playerCount++;
-                            return true; // 继续遍历
-                        });
-                        getSelf().getLogger().debug("Broadcasted to {} players in-game", playerCount);
-                    } else {
-                        getSelf().getLogger().warn("Level not available, cannot broadcast message");
-                    }
-
-                    getSelf().getLogger().info("[Group->Server] [{}] {}: {}", groupName, nickname, content);
-                } else {
-                    getSelf().getLogger().debug("Ignoring message with type: {}", type);
+                if (type != "group_to_server") {
+                    handleGroupMessage({.type = type});
+                    return;
                 }
+                std::string groupId = json.value("group_id", "");
+                std::string groupName = json.value("group_name", "");
+                std::string nickname = json.value("nickname", "未知用户");
+                std::string content = json.value("message", "");
+                std::string platform = json.value("platform", "");
+                handleGroupMessage({type, groupId, groupName, nickname, content, platform});
             } catch (const nlohmann::json::parse_error& e) {
-                getSelf().getLogger().error("JSON parse error: {}", e.what());
-                getSelf().getLogger().debug("Invalid JSON: {}", message);
+                getSelf().getLogger().error("{} parse error: {}", binary ? "MessagePack" : "JSON", e.what());
+                if (!binary) {
+                    MCWS_DEBUG(getSelf().getLogger(), "Invalid JSON: {}", message);
+                }
             } catch (const std::exception& e) {
                 getSelf().getLogger().error("Failed to process message: {}", e.what());
             }
@@ -239,6 +458,30 @@ bool MclistenerWsServerMod::enable() {
         getSelf().getLogger().debug("Group message receiving is disabled in config");
     }
 
+    getSelf().getLogger().debug("Starting WebSocket server on {}:{}...", std::string(mConfig.host), mConfig.port);
+    if (!mWsServer->start()) {
+        getSelf().getLogger().error("Failed to start WebSocket server!");
+        getSelf().getLogger().fatal("Plugin cannot function without WebSocket server!");
+        // 释放已创建的部分，不留下运行中的日志线程和映射的日志文件
+        mInboundQueue.reset();
+        mWsServer.reset();
+        mJournal.reset();
+        mCoreLogger.reset();
+        if (mLogSink) {
+            mLogSink->stop();
+            mLogSink.reset();
+        }
+        return false;
+    }
+
+    // 服务器启动成功后才设置全局实例指针，tick hook 和聊天 hook 不会调用初始化失败的插件
+    g_modInstance = this;
+
+    // 启动事件分发工作线程
+    mEventDispatcher = std::make_unique<EventDispatcher>(*mWsServer, mConfig, *mCoreLogger);
+    mEventDispatcher->setJournal(mJournal.get());
+    mEventDispatcher->start();
+
     auto& eventBus = ll::event::EventBus::getInstance();
     getSelf().getLogger().debug("Registering event listeners...");
 
@@ -249,18 +492,18 @@ bool MclistenerWsServerMod::enable() {
         
         mPlayerJoinListener = eventBus.emplaceListener<ll::event::PlayerJoinEvent>(
             [this](ll::event::PlayerJoinEvent& event) {
-                getSelf().getLogger().trace("PlayerJoinEvent triggered");
+                MCWS_TRACE(getSelf().getLogger(), "PlayerJoinEvent triggered");
                 auto& player = event.self();
                 std::string playerName = player.getRealName();
 
-                nlohmann::json msg;
-                msg["type"] = "player_join";
-                msg["player_name"] = playerName;
-
-                std::string jsonStr = msg.dump();
-                getSelf().getLogger().trace("Broadcasting JSON: {}", jsonStr);
-                mWsServer->broadcast(jsonStr);
-                getSelf().getLogger().info("[Server->WS] Player {} joined", playerName);
+                logInfo("[Server->WS] Player {} joined", playerName);
+                mEventDispatcher->post(OutboundEvent{
+                    EventType::PlayerJoin,
+                    CaptureSource::Event,
+                    getCurrentTick(),
+                    std::move(playerName),
+                    {}
+                });
             }
         );
         
@@ -280,18 +523,18 @@ bool MclistenerWsServerMod::enable() {
         
         mPlayerLeaveListener = eventBus.emplaceListener<ll::event::PlayerDisconnectEvent>(
             [this](ll::event::PlayerDisconnectEvent& event) {
-                getSelf().getLogger().trace("PlayerDisconnectEvent triggered");
+                MCWS_TRACE(getSelf().getLogger(), "PlayerDisconnectEvent triggered");
                 auto& player = event.self();
                 std::string playerName = player.getRealName();
 
-                nlohmann::json msg;
-                msg["type"] = "player_leave";
-                msg["player_name"] = playerName;
-
-                std::string jsonStr = msg.dump();
-                getSelf().getLogger().trace("Broadcasting JSON: {}", jsonStr);
-                mWsServer->broadcast(jsonStr);
-                getSelf().getLogger().info("[Server->WS] Player {} left", playerName);
+                logInfo("[Server->WS] Player {} left", playerName);
+                mEventDispatcher->post(OutboundEvent{
+                    EventType::PlayerLeave,
+                    CaptureSource::Event,
+                    getCurrentTick(),
+                    std::move(playerName),
+                    {}
+                });
             }
         );
         
@@ -306,9 +549,6 @@ bool MclistenerWsServerMod::enable() {
 
     // 订阅玩家聊天事件
     if (mConfig.enablePlayerChatBroadcast) {
-        // 设置全局实例指针供 hook 使用
-        g_modInstance = this;
-        
         std::string mode = mConfig.chatCaptureMode;
         std::transform(mode.begin(), mode.end(), mode.begin(), 
                        [](unsigned char c){ return std::tolower(c); });
@@ -324,22 +564,21 @@ bool MclistenerWsServerMod::enable() {
             // 这样即使 GwChat 等插件取消事件，我们也能捕获到消息
             mPlayerChatListener = eventBus.emplaceListener<ll::event::PlayerChatEvent>(
                 [this](ll::event::PlayerChatEvent& event) {
-                    getSelf().getLogger().trace("PlayerChatEvent triggered (High priority)");
+                    MCWS_TRACE(getSelf().getLogger(), "PlayerChatEvent triggered (High priority)");
                     auto& player = event.self();
                     std::string playerName = player.getRealName();
                     std::string message = event.message();
 
-                    getSelf().getLogger().debug("[Chat] {} said: {}", playerName, message);
+                    MCWS_DEBUG(getSelf().getLogger(), "[Chat] {} said: {}", playerName, message);
+                    logInfo("[Server->WS][Event] Chat from {}: {}", playerName, message);
 
-                    nlohmann::json msg;
-                    msg["type"] = "player_msg";
-                    msg["player_name"] = playerName;
-                    msg["content"] = message;
-
-                    std::string jsonStr = msg.dump();
-                    getSelf().getLogger().trace("Broadcasting JSON: {}", jsonStr);
-                    mWsServer->broadcast(jsonStr);
-                    getSelf().getLogger().info("[Server->WS][Event] Chat from {}: {}", playerName, message);
+                    mEventDispatcher->post(OutboundEvent{
+                        EventType::PlayerChat,
+                        CaptureSource::Event,
+                        getCurrentTick(),
+                        std::move(playerName),
+                        std::move(message)
+                    });
                 },
                 ll::event::EventPriority::High  // 优先级: High(100) < Normal(200)，先执行
             );
@@ -366,18 +605,19 @@ bool MclistenerWsServerMod::enable() {
             bool hasEvent = eventBus.hasEvent(ll::event::getEventId<ll::event::PlayerChatEvent>);
             mPlayerChatListener = eventBus.emplaceListener<ll::event::PlayerChatEvent>(
                 [this](ll::event::PlayerChatEvent& event) {
-                    getSelf().getLogger().trace("PlayerChatEvent triggered");
+                    MCWS_TRACE(getSelf().getLogger(), "PlayerChatEvent triggered");
                     auto& player = event.self();
                     std::string playerName = player.getRealName();
                     std::string message = event.message();
 
-                    nlohmann::json msg;
-                    msg["type"] = "player_msg";
-                    msg["player_name"] = playerName;
-                    msg["content"] = message;
-
-                    mWsServer->broadcast(msg.dump());
-                    getSelf().getLogger().info("[Server->WS] Chat from {}: {}", playerName, message);
+                    logInfo("[Server->WS] Chat from {}: {}", playerName, message);
+                    mEventDispatcher->post(OutboundEvent{
+                        EventType::PlayerChat,
+                        CaptureSource::Event,
+                        getCurrentTick(),
+                        std::move(playerName),
+                        std::move(message)
+                    });
                 }
             );
         }
@@ -422,6 +662,13 @@ bool MclistenerWsServerMod::disable() {
         getSelf().getLogger().debug("PlayerChatEvent listener removed");
     }
 
+    // 停止事件分发线程 (会先处理完已入队的事件)
+    if (mEventDispatcher) {
+        getSelf().getLogger().debug("Stopping event dispatcher...");
+        mEventDispatcher->stop();
+        mEventDispatcher.reset();
+    }
+
     // 停止 WebSocket 服务器
     if (mWsServer) {
         getSelf().getLogger().debug("Stopping WebSocket server...");
@@ -429,6 +676,22 @@ bool MclistenerWsServerMod::disable() {
         mWsServer.reset();
         getSelf().getLogger().debug("WebSocket server stopped and cleaned up");
     }
+    mJournal.reset();
+    mCoreLogger.reset();
+
+    // 服务器停止后不会再有新的入站消息，丢弃尚未处理的部分
+    if (mInboundQueue) {
+        getSelf().getLogger().debug("Inbound messages: {} processed, {} dropped, {} ticks hit the per-tick budget",
+                                    mInboundQueue->getProcessedCount(), mInboundQueue->getDroppedCount(),
+                                    mInboundQueue->getDeferredTickCount());
+        mInboundQueue.reset();
+    }
+
+    // 最后停止异步日志，输出完剩余的日志
+    if (mLogSink) {
+        mLogSink->stop();
+        mLogSink.reset();
+    }
 
     getSelf().getLogger().info("mclistener-ws-server disabled successfully!");
     return true;
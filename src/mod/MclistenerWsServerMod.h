@@ -2,14 +2,25 @@
 
 #include "ll/api/mod/NativeMod.h"
 #include "ll/api/event/ListenerBase.h"
+#include "mod/AsyncLogSink.h"
 #include "mod/Config.h"
+#include "mod/Log.h"
+#include "mod/MessageTemplate.h"
 
+#include <fmt/format.h>
+
+#include <cstdint>
 #include <memory>
+#include <utility>
 
 namespace mclistener_ws_server {
 
 // 前向声明
 class WebSocketServer;
+class EventDispatcher;
+class EventJournal;
+class InboundQueue;
+struct GroupMessageFields;
 
 class MclistenerWsServerMod {
 
@@ -24,6 +35,30 @@ public:
 
     [[nodiscard]] WebSocketServer* getWebSocketServer() const { return mWsServer.get(); }
 
+    [[nodiscard]] EventDispatcher* getEventDispatcher() const { return mEventDispatcher.get(); }
+
+    // 当前服务器 tick 计数 (由 Level::tick hook 递增)
+    [[nodiscard]] static uint64_t getCurrentTick();
+
+    // 在游戏线程的 tick 中按预算处理排队的入站群消息
+    void processInboundMessages();
+
+    // 在游戏线程的 tick 中按 telemetryIntervalTicks 采样所有玩家，交给分发线程编码
+    void sampleTelemetry(uint64_t tick);
+
+    // 事件处理函数中的 info 日志: 开启异步日志时只格式化并入队，由日志线程输出
+    template <typename... Args>
+    void logInfo(fmt::format_string<Args...> format, Args&&... args) {
+        if (!shouldLog(LogLevel::Info)) {
+            return;
+        }
+        if (mLogSink) {
+            mLogSink->post(LogLevel::Info, fmt::format(format, std::forward<Args>(args)...));
+        } else {
+            getSelf().getLogger().info(format, std::forward<Args>(args)...);
+        }
+    }
+
     /// @return True if the mod is loaded successfully.
     bool load();
 
@@ -34,11 +69,35 @@ public:
     bool disable();
 
 private:
+    // 处理一条已取出字段的入站消息 (事件循环线程)，群消息格式化后放入入站队列
+    void handleGroupMessage(const GroupMessageFields& fields);
+
     ll::mod::NativeMod& mSelf;
     Config mConfig;
+
+    // 由 groupMessageFormat 编译得到的模板
+    MessageTemplate mGroupMessageTemplate;
+
+    // 上一次遥测采样的玩家数，用于预分配 (只由游戏线程访问)
+    size_t mLastTelemetryPlayers = 0;
     
+    // 供 WebSocketServer 等核心代码使用的日志接口，转发给插件的 logger
+    std::unique_ptr<Logger> mCoreLogger;
+
+    // 出站事件日志 (enableEventJournal 关闭或打开失败时为空)，需比服务器和分发线程活得更久
+    std::unique_ptr<EventJournal> mJournal;
+
     // WebSocket 服务器实例
     std::unique_ptr<WebSocketServer> mWsServer;
+
+    // 游戏事件 -> WebSocket 的异步分发管线
+    std::unique_ptr<EventDispatcher> mEventDispatcher;
+
+    // WebSocket -> 游戏线程的入站消息队列
+    std::unique_ptr<InboundQueue> mInboundQueue;
+
+    // 异步日志输出 (enableAsyncLogging 关闭时为空)
+    std::unique_ptr<AsyncLogSink> mLogSink;
     
     // 事件监听器
     ll::event::ListenerPtr mPlayerJoinListener;
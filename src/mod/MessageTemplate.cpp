@@ -0,0 +1,79 @@
+#include "mod/MessageTemplate.h"
+
+namespace mclistener_ws_server {
+
+// 占位符名称，与 Field 的顺序一致
+static constexpr std::string_view FIELD_NAMES[MessageTemplate::FieldCount] = {
+    "{group_id}",
+    "{group_name}",
+    "{nickname}",
+    "{message}",
+    "{timestamp}",
+    "{platform}",
+};
+
+MessageTemplate MessageTemplate::compile(std::string_view format) {
+    MessageTemplate result;
+
+    // 把字面量追加到上一个字面量片段，相邻的字面量合并为一段
+    auto appendLiteral = [&result](std::string_view text) {
+        if (text.empty()) {
+            return;
+        }
+        if (result.mSegments.empty() || result.mSegments.back().isField) {
+            result.mSegments.push_back(Segment{false, Field::GroupId, result.mLiterals.size(), 0});
+        }
+        result.mLiterals.append(text);
+        result.mSegments.back().length += text.size();
+    };
+
+    size_t pos = 0;
+    while (pos < format.size()) {
+        size_t open = format.find('{', pos);
+        if (open == std::string_view::npos) {
+            appendLiteral(format.substr(pos));
+            break;
+        }
+        appendLiteral(format.substr(pos, open - pos));
+
+        bool matched = false;
+        for (size_t i = 0; i < FieldCount; ++i) {
+            if (format.compare(open, FIELD_NAMES[i].size(), FIELD_NAMES[i]) == 0) {
+                result.mSegments.push_back(Segment{true, static_cast<Field>(i), 0, 0});
+                result.mUsedFields |= 1u << i;
+                pos = open + FIELD_NAMES[i].size();
+                matched = true;
+                break;
+            }
+        }
+        if (!matched) {
+            // 无法识别的 '{' 按字面量输出
+            appendLiteral(format.substr(open, 1));
+            pos = open + 1;
+        }
+    }
+
+    return result;
+}
+
+std::string MessageTemplate::render(const Values& values) const {
+    size_t total = mLiterals.size();
+    for (const auto& segment : mSegments) {
+        if (segment.isField) {
+            total += values[static_cast<size_t>(segment.field)].size();
+        }
+    }
+
+    std::string output;
+    output.reserve(total);
+    for (const auto& segment : mSegments) {
+        if (segment.isField) {
+            output.append(values[static_cast<size_t>(segment.field)]);
+        } else {
+            output.append(mLiterals, segment.offset, segment.length);
+        }
+    }
+    return output;
+}
+
+} // namespace mclistener_ws_server
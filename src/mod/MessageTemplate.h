@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mclistener_ws_server {
+
+/**
+ * 预编译的消息格式模板 (如 groupMessageFormat)
+ *
+ * 格式字符串在加载配置时解析一次，拆分为字面量片段和占位符槽位；
+ * 渲染时按片段顺序一次性写入预留好容量的缓冲区。
+ * 替换进来的值不会再被扫描，昵称或消息中包含 "{message}" 之类的文本会原样输出。
+ * 无法识别的 {xxx} 按字面量处理。
+ */
+class MessageTemplate {
+public:
+    // 支持的占位符
+    enum class Field : uint8_t {
+        GroupId,   // {group_id}
+        GroupName, // {group_name}
+        Nickname,  // {nickname}
+        Message,   // {message}
+        Timestamp, // {timestamp} 服务器收到消息时的本地时间 (HH:MM:SS)
+        Platform,  // {platform} 消息来源平台 (由客户端提供)
+    };
+
+    static constexpr size_t FieldCount = 6;
+
+    // 按 Field 顺序排列的替换值
+    using Values = std::array<std::string_view, FieldCount>;
+
+    MessageTemplate() = default;
+
+    // 解析格式字符串
+    static MessageTemplate compile(std::string_view format);
+
+    // 单次遍历渲染
+    std::string render(const Values& values) const;
+
+    // 模板中是否使用了某个占位符，未使用的值可以不计算
+    bool uses(Field field) const { return (mUsedFields & (1u << static_cast<unsigned>(field))) != 0; }
+
+private:
+    struct Segment {
+        bool   isField;
+        Field  field;
+        size_t offset; // 字面量在 mLiterals 中的位置
+        size_t length;
+    };
+
+    std::string mLiterals;
+    std::vector<Segment> mSegments;
+    uint32_t mUsedFields = 0;
+};
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,168 @@
+#include "mod/Metrics.h"
+
+namespace mclistener_ws_server {
+
+// 直方图桶上界，纳秒值用于比较，字符串用于输出 le 标签
+struct BucketBound {
+    uint64_t nanos;
+    const char* label;
+};
+
+static constexpr BucketBound LATENCY_BOUNDS[LatencyHistogram::BucketCount] = {
+    {100'000, "0.0001"},
+    {250'000, "0.00025"},
+    {500'000, "0.0005"},
+    {1'000'000, "0.001"},
+    {2'500'000, "0.0025"},
+    {5'000'000, "0.005"},
+    {10'000'000, "0.01"},
+    {25'000'000, "0.025"},
+    {50'000'000, "0.05"},
+    {100'000'000, "0.1"},
+    {250'000'000, "0.25"},
+    {500'000'000, "0.5"},
+    {1'000'000'000, "1"},
+    {10'000'000'000, "10"},
+};
+
+static constexpr const char* FRAME_KIND_NAMES[FrameKindCount] = {"text", "binary", "ping", "pong", "close", "http"};
+
+static constexpr const char* DISCONNECT_REASON_NAMES[DisconnectReasonCount] = {
+    "queue_overflow", "slow_consumer", "pong_timeout", "idle_timeout", "handshake_timeout", "protocol_error",
+};
+
+static constexpr const char* EVENT_TYPE_NAMES[EventTypeCount] = {"player_join", "player_leave", "player_msg",
+                                                                  "telemetry"};
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& shard : mShards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void LatencyHistogram::observe(std::chrono::nanoseconds latency) {
+    uint64_t nanos = latency.count() > 0 ? static_cast<uint64_t>(latency.count()) : 0;
+    size_t bucket = 0;
+    while (bucket < BucketCount && nanos > LATENCY_BOUNDS[bucket].nanos) {
+        ++bucket;
+    }
+    Shard& shard = mShards[currentMetricShard()];
+    shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sumNanos.fetch_add(nanos, std::memory_order_relaxed);
+}
+
+static void appendHeader(std::string& out, std::string_view name, std::string_view help, std::string_view type) {
+    out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+static void appendSample(std::string& out, std::string_view name, std::string_view labels, uint64_t value) {
+    out.append(name);
+    if (!labels.empty()) {
+        out.append("{").append(labels).append("}");
+    }
+    out.append(" ").append(std::to_string(value)).append("\n");
+}
+
+void LatencyHistogram::render(std::string& out, std::string_view name, std::string_view help) const {
+    std::array<uint64_t, BucketCount + 1> buckets{};
+    uint64_t sumNanos = 0;
+    for (const auto& shard : mShards) {
+        for (size_t i = 0; i <= BucketCount; ++i) {
+            buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+        sumNanos += shard.sumNanos.load(std::memory_order_relaxed);
+    }
+
+    appendHeader(out, name, help, "histogram");
+    std::string bucketName = std::string(name) + "_bucket";
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < BucketCount; ++i) {
+        cumulative += buckets[i];
+        appendSample(out, bucketName, std::string("le=\"") + LATENCY_BOUNDS[i].label + "\"", cumulative);
+    }
+    cumulative += buckets[BucketCount];
+    appendSample(out, bucketName, "le=\"+Inf\"", cumulative);
+
+    // 秒为单位，保留微秒精度
+    out.append(name).append("_sum ").append(std::to_string(sumNanos / 1'000'000'000)).append(".");
+    std::string micros = std::to_string(sumNanos % 1'000'000'000 / 1000);
+    out.append(6 - micros.size(), '0').append(micros).append("\n");
+    appendSample(out, std::string(name) + "_count", {}, cumulative);
+}
+
+FrameKind frameKindFromOpcode(unsigned char opcode) {
+    switch (opcode) {
+    case 0x1: return FrameKind::Text;
+    case 0x2: return FrameKind::Binary;
+    case 0x8: return FrameKind::Close;
+    case 0x9: return FrameKind::Ping;
+    case 0xA: return FrameKind::Pong;
+    default:  return FrameKind::Http;
+    }
+}
+
+// 输出按标签拆分的一组计数器
+template <size_t N>
+static void renderLabeled(std::string& out, std::string_view name, std::string_view help, std::string_view label,
+                          const std::array<Counter, N>& counters, const char* const (&labelValues)[N]) {
+    appendHeader(out, name, help, "counter");
+    for (size_t i = 0; i < N; ++i) {
+        appendSample(out, name, std::string(label) + "=\"" + labelValues[i] + "\"", counters[i].value());
+    }
+}
+
+static void renderCounter(std::string& out, std::string_view name, std::string_view help, const Counter& counter) {
+    appendHeader(out, name, help, "counter");
+    appendSample(out, name, {}, counter.value());
+}
+
+void Metrics::render(std::string& out) const {
+    renderCounter(out, "mclistener_connections_accepted_total", "Accepted TCP connections.", connectionsAccepted);
+    renderCounter(out, "mclistener_handshake_failures_total", "Connections rejected during the WebSocket handshake.",
+                  handshakeFailures);
+    renderCounter(out, "mclistener_http_requests_total", "Plain HTTP requests (/metrics, /healthz).", httpRequests);
+    renderLabeled(out, "mclistener_disconnects_total", "Connections closed by the server.", "reason", disconnects,
+                  DISCONNECT_REASON_NAMES);
+
+    renderLabeled(out, "mclistener_frames_received_total", "Frames received from clients.", "type", framesIn,
+                  FRAME_KIND_NAMES);
+    renderLabeled(out, "mclistener_bytes_received_total", "Frame bytes received from clients.", "type", bytesIn,
+                  FRAME_KIND_NAMES);
+    renderLabeled(out, "mclistener_frames_sent_total", "Frames fully written to clients.", "type", framesOut,
+                  FRAME_KIND_NAMES);
+    renderLabeled(out, "mclistener_bytes_sent_total", "Frame bytes fully written to clients.", "type", bytesOut,
+                  FRAME_KIND_NAMES);
+
+    renderLabeled(out, "mclistener_events_broadcast_total", "Game events broadcast to clients.", "event",
+                  eventsBroadcast, EVENT_TYPE_NAMES);
+    renderCounter(out, "mclistener_events_dropped_total", "Game events dropped because the event queue was full.",
+                  eventsDropped);
+    renderCounter(out, "mclistener_send_queue_dropped_total", "Frames dropped because a client send queue was full.",
+                  sendQueueDropped);
+    renderCounter(out, "mclistener_events_replayed_total", "Journaled events replayed to resuming clients.",
+                  eventsReplayed);
+    renderCounter(out, "mclistener_chat_duplicates_dropped_total",
+                  "Chat messages captured by both the packet hook and the chat event, dropped as duplicates.",
+                  chatDuplicatesDropped);
+    renderCounter(out, "mclistener_chat_rate_limited_total",
+                  "Chat messages dropped because the player exceeded the chat rate limit.", chatRateLimited);
+
+    renderCounter(out, "mclistener_inbound_messages_total", "Group messages received for the game.", inboundReceived);
+    renderCounter(out, "mclistener_inbound_dropped_total", "Group messages dropped because the inbound queue was full.",
+                  inboundDropped);
+    renderCounter(out, "mclistener_inbound_rate_limited_total",
+                  "Client messages dropped because the connection exceeded the message rate limit.",
+                  inboundRateLimited);
+
+    dispatchLatency.render(out, "mclistener_dispatch_latency_seconds",
+                           "Time from capturing a game event to queueing it for all clients.");
+    sendLatency.render(out, "mclistener_send_latency_seconds",
+                       "Time from building a broadcast frame to fully writing it to a client.");
+    inboundLatency.render(out, "mclistener_inbound_latency_seconds",
+                          "Time from receiving a group message to delivering it on the game tick.");
+}
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "mod/OutboundEvent.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace mclistener_ws_server {
+
+// 计数器分片数: 游戏线程、事件循环线程、分发线程等各自落在不同分片，互不争用缓存行
+inline constexpr size_t MetricShardCount = 8;
+
+// 当前线程使用的分片下标，线程第一次写入时按顺序分配
+inline size_t currentMetricShard() {
+    static std::atomic<size_t> nextShard{0};
+    thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % MetricShardCount;
+    return shard;
+}
+
+/**
+ * 分片的单调递增计数器
+ * 写入只是对当前线程分片的一次 relaxed 原子加，不加锁；
+ * 读取时汇总所有分片，只在抓取 /metrics 时发生
+ */
+class Counter {
+public:
+    void add(uint64_t n = 1) { mShards[currentMetricShard()].value.fetch_add(n, std::memory_order_relaxed); }
+
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+
+    std::array<Shard, MetricShardCount> mShards;
+};
+
+/**
+ * 分片的延迟直方图，桶边界固定 (100us ~ 10s)
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t BucketCount = 14;
+
+    void observe(std::chrono::nanoseconds latency);
+
+    // 以 Prometheus 文本格式追加 <name>_bucket / _sum / _count
+    void render(std::string& out, std::string_view name, std::string_view help) const;
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, BucketCount + 1> buckets{}; // 最后一个为 +Inf
+        std::atomic<uint64_t> sumNanos{0};
+    };
+
+    std::array<Shard, MetricShardCount> mShards;
+};
+
+// 按 opcode 区分的帧类型，http 为握手响应和 /metrics 等普通 HTTP 响应
+enum class FrameKind : uint8_t { Text, Binary, Ping, Pong, Close, Http };
+inline constexpr size_t FrameKindCount = 6;
+
+// 由 WebSocket opcode 得到帧类型，raw 数据 (opcode 0) 视为 http
+FrameKind frameKindFromOpcode(unsigned char opcode);
+
+// 服务端主动断开连接的原因
+enum class DisconnectReason : uint8_t {
+    QueueOverflow,    // 发送队列溢出 (disconnect 策略)
+    SlowConsumer,     // 发送积压持续超过阈值
+    PongTimeout,      // 未及时回复 ping
+    IdleTimeout,      // 长时间没有收到数据
+    HandshakeTimeout, // 未在时限内完成握手
+    ProtocolError,    // 收到非法帧
+};
+inline constexpr size_t DisconnectReasonCount = 6;
+
+/**
+ * 桥接服务的运行指标，由 WebSocketServer 持有并通过 /metrics 导出
+ * 连接数、发送队列深度等瞬时值在抓取时由事件循环线程直接统计，这里只保存计数器和直方图
+ */
+struct Metrics {
+    Counter connectionsAccepted;
+    Counter handshakeFailures;
+    Counter httpRequests;
+    std::array<Counter, DisconnectReasonCount> disconnects;
+
+    // 按帧类型统计的收发帧数和负载字节数 (压缩帧按压缩后的大小计)
+    std::array<Counter, FrameKindCount> framesIn;
+    std::array<Counter, FrameKindCount> bytesIn;
+    std::array<Counter, FrameKindCount> framesOut;
+    std::array<Counter, FrameKindCount> bytesOut;
+
+    // 游戏事件 -> WebSocket
+    std::array<Counter, EventTypeCount> eventsBroadcast;
+    Counter eventsDropped;
+    Counter sendQueueDropped;
+    // 客户端 resume 后从事件日志重放的事件
+    Counter eventsReplayed;
+    // chatCaptureMode 为 "both" 时被去重丢弃的聊天
+    Counter chatDuplicatesDropped;
+    // 超出 playerChatRateLimit 被丢弃的聊天
+    Counter chatRateLimited;
+
+    // WebSocket -> 游戏线程
+    Counter inboundReceived;
+    Counter inboundDropped;
+    // 超出 clientMessageRateLimit 被丢弃的客户端消息
+    Counter inboundRateLimited;
+
+    // 游戏线程捕获事件到入队广播
+    LatencyHistogram dispatchLatency;
+    // 广播帧构造完成到完整写入某个客户端的 socket
+    LatencyHistogram sendLatency;
+    // 收到群消息到在游戏 tick 中发给玩家
+    LatencyHistogram inboundLatency;
+
+    // 以 Prometheus 文本格式追加所有计数器和直方图
+    void render(std::string& out) const;
+};
+
+} // namespace mclistener_ws_server
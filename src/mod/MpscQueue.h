@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace mclistener_ws_server {
+
+/**
+ * 有界无锁多生产者 / 单消费者环形队列
+ * 每个槽位带一个序号 (Vyukov 有界队列)，生产者只需一次 CAS 抢占槽位，
+ * 队列满时 tryPush 立即返回 false，绝不阻塞生产者线程
+ */
+template <typename T>
+class MpscQueue {
+public:
+    // 容量会向上取整为 2 的幂
+    explicit MpscQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mMask  = size - 1;
+        mCells = std::make_unique<Cell[]>(size);
+        for (size_t i = 0; i < size; ++i) {
+            mCells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // 任意线程调用，队列满时返回 false
+    bool tryPush(T&& value) {
+        size_t pos = mTail.load(std::memory_order_relaxed);
+        Cell*  cell;
+        while (true) {
+            cell         = &mCells[pos & mMask];
+            size_t seq   = cell->sequence.load(std::memory_order_acquire);
+            auto   diff  = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (mTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // 队列已满
+            } else {
+                pos = mTail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 只能由唯一的消费者线程调用，队列为空时返回 false
+    bool tryPop(T& out) {
+        Cell&  cell = mCells[mHead & mMask];
+        size_t seq  = cell.sequence.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(mHead + 1) < 0) {
+            return false;
+        }
+        out = std::move(cell.value);
+        cell.sequence.store(mHead + mMask + 1, std::memory_order_release);
+        ++mHead;
+        return true;
+    }
+
+    // 只能由消费者线程调用
+    bool empty() const {
+        const Cell& cell = mCells[mHead & mMask];
+        return static_cast<intptr_t>(cell.sequence.load(std::memory_order_acquire))
+             - static_cast<intptr_t>(mHead + 1) < 0;
+    }
+
+    size_t capacity() const { return mMask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence{0};
+        T value{};
+    };
+
+    std::unique_ptr<Cell[]> mCells;
+    size_t mMask = 0;
+
+    // 生产者和消费者的游标放在不同缓存行，避免伪共享
+    alignas(64) std::atomic<size_t> mTail{0};
+    alignas(64) size_t mHead = 0;
+};
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace mclistener_ws_server {
+
+// 出站事件类型
+enum class EventType : uint8_t {
+    PlayerJoin,
+    PlayerLeave,
+    PlayerChat,
+    Telemetry, // 周期性采样的玩家状态，只发给显式订阅的客户端
+};
+
+inline constexpr size_t EventTypeCount = 4;
+
+// 事件在消息 "type" 字段中的名称，也是 subscribe 消息中使用的主题名
+inline constexpr std::array<const char*, EventTypeCount> EventTypeNames = {"player_join", "player_leave", "player_msg",
+                                                                           "telemetry"};
+
+// 按名称查找事件类型
+inline bool parseEventType(std::string_view name, EventType& type) {
+    for (size_t i = 0; i < EventTypeCount; ++i) {
+        if (name == EventTypeNames[i]) {
+            type = static_cast<EventType>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+struct TelemetrySnapshot;
+
+// 事件的捕获来源
+enum class CaptureSource : uint8_t {
+    Event,      // LeviLamina 事件系统
+    PacketHook, // TextPacket hook
+};
+
+/**
+ * 游戏线程产生的紧凑事件记录
+ * 游戏线程只负责填充字段并入队，JSON 序列化和广播由 EventDispatcher 的工作线程完成
+ */
+struct OutboundEvent {
+    EventType     type   = EventType::PlayerJoin;
+    CaptureSource source = CaptureSource::Event;
+    uint64_t      tick   = 0; // 捕获时的服务器 tick
+    std::string   playerName;
+    std::string   content; // 仅聊天事件使用
+    uint32_t      suppressed = 0; // 此前因限流被丢弃的该玩家聊天条数，由分发线程填写
+    std::shared_ptr<const TelemetrySnapshot> telemetry; // 仅遥测事件使用
+    // 捕获时间，用于统计分发延迟
+    std::chrono::steady_clock::time_point capturedAt = std::chrono::steady_clock::now();
+};
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,235 @@
+#include "mod/PerMessageDeflate.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cctype>
+#include <set>
+#include <vector>
+
+namespace mclistener_ws_server {
+
+// RFC 7692 7.2.1: 每条压缩消息末尾需要移除 / 补回的空存储块
+static const unsigned char DEFLATE_TAIL[4] = {0x00, 0x00, 0xff, 0xff};
+
+// 解压时每次扩展输出缓冲区的大小
+static constexpr size_t INFLATE_CHUNK_SIZE = 4096;
+
+static std::string trim(const std::string& str) {
+    size_t start = str.find_first_not_of(" \t");
+    if (start == std::string::npos) {
+        return "";
+    }
+    size_t end = str.find_last_not_of(" \t");
+    return str.substr(start, end - start + 1);
+}
+
+static std::vector<std::string> split(const std::string& str, char delimiter) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (true) {
+        size_t pos = str.find(delimiter, start);
+        parts.push_back(trim(str.substr(start, pos == std::string::npos ? std::string::npos : pos - start)));
+        if (pos == std::string::npos) {
+            return parts;
+        }
+        start = pos + 1;
+    }
+}
+
+// 解析窗口大小参数，值必须是 8-15 的整数 (可以带引号)
+static bool parseWindowBits(std::string value, int& bits) {
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+        value = value.substr(1, value.size() - 2);
+    }
+    if (value.empty() || value.size() > 2
+        || !std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        return false;
+    }
+    bits = std::stoi(value);
+    return bits >= 8 && bits <= 15;
+}
+
+bool negotiatePerMessageDeflate(
+    const std::string& offerHeader,
+    bool requestClientNoContextTakeover,
+    DeflateParams& params,
+    std::string& responseValue
+) {
+    // 多个提议以逗号分隔，按客户端给出的优先级依次尝试
+    for (const auto& offer : split(offerHeader, ',')) {
+        auto parts = split(offer, ';');
+        std::string name = parts[0];
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (name != "permessage-deflate") {
+            continue;
+        }
+
+        DeflateParams candidate;
+        candidate.enabled = true;
+        bool valid = true;
+        bool serverWindowRequested = false;
+        std::set<std::string> seen;
+
+        for (size_t i = 1; i < parts.size() && valid; ++i) {
+            size_t eq = parts[i].find('=');
+            std::string key = trim(parts[i].substr(0, eq));
+            std::string value = eq == std::string::npos ? "" : trim(parts[i].substr(eq + 1));
+            std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return std::tolower(c); });
+
+            // 同一参数重复出现时拒绝该提议
+            if (!seen.insert(key).second) {
+                valid = false;
+            } else if (key == "server_no_context_takeover") {
+                valid = eq == std::string::npos;
+            } else if (key == "client_no_context_takeover") {
+                valid = eq == std::string::npos;
+                candidate.clientNoContextTakeover = true;
+            } else if (key == "server_max_window_bits") {
+                valid = parseWindowBits(value, candidate.serverMaxWindowBits);
+                serverWindowRequested = true;
+            } else if (key == "client_max_window_bits") {
+                // 客户端表示支持限制自身窗口，服务端解压器按 15 位窗口即可处理任何取值
+                int bits = 15;
+                valid = eq == std::string::npos || parseWindowBits(value, bits);
+            } else {
+                valid = false; // 未知参数
+            }
+        }
+
+        // zlib 不支持 8 位窗口的原始 deflate 流
+        if (!valid || candidate.serverMaxWindowBits < 9) {
+            continue;
+        }
+
+        if (requestClientNoContextTakeover) {
+            candidate.clientNoContextTakeover = true;
+        }
+
+        responseValue = "permessage-deflate; server_no_context_takeover";
+        if (candidate.clientNoContextTakeover) {
+            responseValue += "; client_no_context_takeover";
+        }
+        if (serverWindowRequested) {
+            responseValue += "; server_max_window_bits=" + std::to_string(candidate.serverMaxWindowBits);
+        }
+
+        params = candidate;
+        return true;
+    }
+    return false;
+}
+
+DeflateCompressor::DeflateCompressor(int windowBits) : mStream(new z_stream{}) {
+    // 负的 windowBits 表示输出不带 zlib 头尾的原始 deflate 流
+    mReady = deflateInit2(mStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -windowBits, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+DeflateCompressor::~DeflateCompressor() {
+    if (mReady) {
+        deflateEnd(mStream);
+    }
+    delete mStream;
+}
+
+bool DeflateCompressor::compress(const std::string& input, std::string& output) {
+    if (!mReady || deflateReset(mStream) != Z_OK) {
+        return false;
+    }
+
+    // deflateBound 按 Z_FINISH 估算，同步刷新还会多出几个字节
+    output.resize(deflateBound(mStream, static_cast<uLong>(input.size())) + 16);
+    mStream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    mStream->avail_in = static_cast<uInt>(input.size());
+    mStream->next_out = reinterpret_cast<Bytef*>(output.data());
+    mStream->avail_out = static_cast<uInt>(output.size());
+
+    // Z_SYNC_FLUSH 以空存储块结尾，正好对应需要移除的 4 字节尾部
+    int result = deflate(mStream, Z_SYNC_FLUSH);
+    if (result != Z_OK || mStream->avail_in != 0) {
+        return false;
+    }
+
+    size_t produced = output.size() - mStream->avail_out;
+    if (produced >= 4 && std::equal(DEFLATE_TAIL, DEFLATE_TAIL + 4, output.data() + produced - 4,
+                                    [](unsigned char a, char b) { return a == static_cast<unsigned char>(b); })) {
+        produced -= 4;
+    }
+    output.resize(produced);
+    return true;
+}
+
+DeflateDecompressor::DeflateDecompressor(bool noContextTakeover)
+    : mStream(new z_stream{}), mNoContextTakeover(noContextTakeover) {
+    mReady = inflateInit2(mStream, -15) == Z_OK;
+}
+
+DeflateDecompressor::~DeflateDecompressor() {
+    if (mReady) {
+        inflateEnd(mStream);
+    }
+    delete mStream;
+}
+
+bool DeflateDecompressor::decompress(const char* data, size_t length, std::string& output, size_t maxSize) {
+    if (!mReady) {
+        return false;
+    }
+
+    output.clear();
+
+    // 依次输入消息体和补回的尾部
+    const unsigned char* inputs[2] = {reinterpret_cast<const unsigned char*>(data), DEFLATE_TAIL};
+    size_t lengths[2] = {length, sizeof(DEFLATE_TAIL)};
+
+    bool ok = true;
+    bool streamEnd = false;
+    for (int part = 0; part < 2 && ok && !streamEnd; ++part) {
+        mStream->next_in = const_cast<Bytef*>(inputs[part]);
+        mStream->avail_in = static_cast<uInt>(lengths[part]);
+
+        while (true) {
+            size_t used = output.size();
+            if (used >= maxSize) {
+                // 输出已达上限: 用一字节的探测缓冲区确认，只有确实还有待输出的数据时才算超限，
+                // 解压后恰好为 maxSize 字节的消息仍然合法
+                unsigned char probe;
+                mStream->next_out = &probe;
+                mStream->avail_out = 1;
+                int result = inflate(mStream, Z_SYNC_FLUSH);
+                if (mStream->avail_out == 0 || (result != Z_OK && result != Z_BUF_ERROR && result != Z_STREAM_END)) {
+                    ok = false;
+                } else {
+                    streamEnd = result == Z_STREAM_END;
+                }
+                break;
+            }
+            size_t grow = std::min(INFLATE_CHUNK_SIZE, maxSize - used);
+            output.resize(used + grow);
+            mStream->next_out = reinterpret_cast<Bytef*>(output.data() + used);
+            mStream->avail_out = static_cast<uInt>(grow);
+
+            int result = inflate(mStream, Z_SYNC_FLUSH);
+            output.resize(used + grow - mStream->avail_out);
+            if (result == Z_STREAM_END) {
+                streamEnd = true;
+                break;
+            }
+            if (result != Z_OK && result != Z_BUF_ERROR) {
+                ok = false;
+                break;
+            }
+            // 输入已耗尽且没有待输出的数据
+            if (result == Z_BUF_ERROR || (mStream->avail_in == 0 && mStream->avail_out != 0)) {
+                break;
+            }
+        }
+    }
+
+    if (mNoContextTakeover || streamEnd || !ok) {
+        inflateReset(mStream);
+    }
+    return ok;
+}
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// zlib 前向声明，避免在头文件中引入 zlib.h
+struct z_stream_s;
+
+namespace mclistener_ws_server {
+
+/**
+ * permessage-deflate (RFC 7692) 协商结果
+ *
+ * 服务端总是使用 server_no_context_takeover: 每条消息独立压缩，
+ * 这样同一条广播只需压缩一次，压缩结果可以被所有窗口参数相同的客户端共享
+ */
+struct DeflateParams {
+    bool enabled = false;
+    int serverMaxWindowBits = 15;       // 服务端压缩使用的窗口大小 (9-15)
+    bool clientNoContextTakeover = false; // 客户端每条消息独立压缩，服务端无需保留解压窗口
+};
+
+// 解析客户端的 Sec-WebSocket-Extensions 请求头并选出第一个可接受的 permessage-deflate 提议
+// 成功时填充 params，并生成响应头的值 (不含 "Sec-WebSocket-Extensions: " 前缀)
+bool negotiatePerMessageDeflate(
+    const std::string& offerHeader,
+    bool requestClientNoContextTakeover,
+    DeflateParams& params,
+    std::string& responseValue
+);
+
+/**
+ * 无上下文接管的消息压缩器
+ * 同一个实例可以重复使用，每次 compress() 前重置状态，不是线程安全的
+ */
+class DeflateCompressor {
+public:
+    explicit DeflateCompressor(int windowBits);
+    ~DeflateCompressor();
+
+    DeflateCompressor(const DeflateCompressor&) = delete;
+    DeflateCompressor& operator=(const DeflateCompressor&) = delete;
+
+    // 压缩一条完整消息，输出已去掉 RFC 7692 要求移除的 0x00 0x00 0xff 0xff 尾部
+    bool compress(const std::string& input, std::string& output);
+
+private:
+    z_stream_s* mStream = nullptr;
+    bool mReady = false;
+};
+
+/**
+ * 单个连接的入站消息解压器
+ * 客户端使用上下文接管时需要在消息之间保留滑动窗口
+ */
+class DeflateDecompressor {
+public:
+    explicit DeflateDecompressor(bool noContextTakeover);
+    ~DeflateDecompressor();
+
+    DeflateDecompressor(const DeflateDecompressor&) = delete;
+    DeflateDecompressor& operator=(const DeflateDecompressor&) = delete;
+
+    // 解压一条完整消息，解压后超过 maxSize 时返回 false
+    bool decompress(const char* data, size_t length, std::string& output, size_t maxSize);
+
+private:
+    z_stream_s* mStream = nullptr;
+    bool mReady = false;
+    bool mNoContextTakeover;
+};
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,41 @@
+#include "mod/PlayerIdTable.h"
+
+#include <algorithm>
+
+namespace mclistener_ws_server {
+
+uint32_t PlayerIdTable::intern(const std::string& name, bool& isNew) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto [it, inserted] = mIds.try_emplace(name, mNextId);
+    if (inserted) {
+        ++mNextId;
+    }
+    isNew = inserted;
+    return it->second;
+}
+
+uint32_t PlayerIdTable::release(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mIds.find(name);
+    if (it == mIds.end()) {
+        return 0;
+    }
+    uint32_t id = it->second;
+    mIds.erase(it);
+    return id;
+}
+
+std::vector<std::pair<uint32_t, std::string>> PlayerIdTable::snapshot() const {
+    std::vector<std::pair<uint32_t, std::string>> entries;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        entries.reserve(mIds.size());
+        for (const auto& [name, id] : mIds) {
+            entries.emplace_back(id, name);
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+    return entries;
+}
+
+} // namespace mclistener_ws_server
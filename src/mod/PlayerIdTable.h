@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mclistener_ws_server {
+
+/**
+ * 本次服务器运行期间的玩家 ID 表
+ * 支持 player_ids 特性的客户端收到的事件只带玩家 ID，名称在 ID 首次出现时 (player_join 或 hello 应答) 告知一次
+ *
+ * ID 从 1 开始递增，不复用，玩家离开后从表中移除；
+ * 由 EventDispatcher 的工作线程分配和移除，由事件循环线程读取快照，因此加锁 (只在加入 / 离开 / 首次聊天时写入)
+ */
+class PlayerIdTable {
+public:
+    // 返回玩家的 ID，首次出现时分配新 ID 并把 isNew 置为 true
+    uint32_t intern(const std::string& name, bool& isNew);
+
+    // 玩家离开时移除，返回其 ID，0 表示不在表中
+    uint32_t release(const std::string& name);
+
+    // 当前所有 (ID, 名称)，按 ID 排序
+    std::vector<std::pair<uint32_t, std::string>> snapshot() const;
+
+private:
+    mutable std::mutex mMutex;
+    std::unordered_map<std::string, uint32_t> mIds;
+    uint32_t mNextId = 1;
+};
+
+} // namespace mclistener_ws_server
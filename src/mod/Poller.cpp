@@ -0,0 +1,208 @@
+#include "mod/Poller.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace mclistener_ws_server {
+
+Poller::~Poller() {
+    close();
+}
+
+#ifdef _WIN32
+
+static SHORT toPollEvents(uint32_t interest) {
+    SHORT events = 0;
+    if (interest & Poller::Readable) events |= POLLRDNORM;
+    if (interest & Poller::Writable) events |= POLLWRNORM;
+    return events;
+}
+
+bool Poller::open() {
+    // 绑定到 127.0.0.1 的随机端口，wakeup() 向自己发送一个字节
+    mWakeSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (mWakeSocket == InvalidSocket) {
+        return false;
+    }
+
+    mWakeAddr.sin_family      = AF_INET;
+    mWakeAddr.sin_port        = 0;
+    mWakeAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int addrLen               = sizeof(mWakeAddr);
+    if (bind(mWakeSocket, (sockaddr*)&mWakeAddr, sizeof(mWakeAddr)) != 0
+        || getsockname(mWakeSocket, (sockaddr*)&mWakeAddr, &addrLen) != 0 || !setNonBlocking(mWakeSocket)) {
+        closeSocket(mWakeSocket);
+        mWakeSocket = InvalidSocket;
+        return false;
+    }
+
+    return add(mWakeSocket, WakeupToken, Readable);
+}
+
+void Poller::close() {
+    if (mWakeSocket != InvalidSocket) {
+        closeSocket(mWakeSocket);
+        mWakeSocket = InvalidSocket;
+    }
+    mPollFds.clear();
+    mTokens.clear();
+    mIndex.clear();
+}
+
+bool Poller::add(SocketHandle socket, uint64_t token, uint32_t interest) {
+    if (mIndex.count(socket)) {
+        return false;
+    }
+    WSAPOLLFD pfd{};
+    pfd.fd     = socket;
+    pfd.events = toPollEvents(interest);
+    mIndex[socket] = mPollFds.size();
+    mPollFds.push_back(pfd);
+    mTokens.push_back(token);
+    return true;
+}
+
+bool Poller::modify(SocketHandle socket, uint64_t token, uint32_t interest) {
+    auto it = mIndex.find(socket);
+    if (it == mIndex.end()) {
+        return false;
+    }
+    mPollFds[it->second].events = toPollEvents(interest);
+    mTokens[it->second]         = token;
+    return true;
+}
+
+void Poller::remove(SocketHandle socket) {
+    auto it = mIndex.find(socket);
+    if (it == mIndex.end()) {
+        return;
+    }
+    // 用末尾元素填补空位，保持数组紧凑
+    size_t index = it->second;
+    size_t last  = mPollFds.size() - 1;
+    if (index != last) {
+        mPollFds[index]            = mPollFds[last];
+        mTokens[index]             = mTokens[last];
+        mIndex[mPollFds[index].fd] = index;
+    }
+    mPollFds.pop_back();
+    mTokens.pop_back();
+    mIndex.erase(it);
+}
+
+int Poller::wait(std::vector<Event>& events, int timeoutMs) {
+    events.clear();
+    int ready = WSAPoll(mPollFds.data(), static_cast<ULONG>(mPollFds.size()), timeoutMs);
+    if (ready <= 0) {
+        return ready < 0 ? -1 : 0;
+    }
+
+    for (size_t i = 0; i < mPollFds.size() && static_cast<int>(events.size()) < ready; ++i) {
+        SHORT revents = mPollFds[i].revents;
+        if (revents == 0) {
+            continue;
+        }
+        if (mTokens[i] == WakeupToken) {
+            // 清空唤醒数据报
+            char drain[64];
+            while (recv(mWakeSocket, drain, sizeof(drain), 0) > 0) {}
+        }
+        uint32_t flags = 0;
+        if (revents & (POLLRDNORM | POLLHUP)) flags |= Readable;
+        if (revents & POLLWRNORM) flags |= Writable;
+        if (revents & (POLLERR | POLLNVAL)) flags |= Error | Readable;
+        events.push_back({mTokens[i], flags});
+    }
+    return static_cast<int>(events.size());
+}
+
+void Poller::wakeup() {
+    char byte = 1;
+    sendto(mWakeSocket, &byte, 1, 0, (const sockaddr*)&mWakeAddr, sizeof(mWakeAddr));
+}
+
+#else
+
+static uint32_t toEpollEvents(uint32_t interest) {
+    uint32_t events = 0;
+    if (interest & Poller::Readable) events |= EPOLLIN | EPOLLRDHUP;
+    if (interest & Poller::Writable) events |= EPOLLOUT;
+    return events;
+}
+
+bool Poller::open() {
+    mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (mEpollFd < 0) {
+        return false;
+    }
+    mWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mWakeFd < 0) {
+        close();
+        return false;
+    }
+    return add(mWakeFd, WakeupToken, Readable);
+}
+
+void Poller::close() {
+    if (mWakeFd >= 0) {
+        ::close(mWakeFd);
+        mWakeFd = -1;
+    }
+    if (mEpollFd >= 0) {
+        ::close(mEpollFd);
+        mEpollFd = -1;
+    }
+}
+
+bool Poller::add(SocketHandle socket, uint64_t token, uint32_t interest) {
+    epoll_event ev{};
+    ev.events   = toEpollEvents(interest);
+    ev.data.u64 = token;
+    return epoll_ctl(mEpollFd, EPOLL_CTL_ADD, socket, &ev) == 0;
+}
+
+bool Poller::modify(SocketHandle socket, uint64_t token, uint32_t interest) {
+    epoll_event ev{};
+    ev.events   = toEpollEvents(interest);
+    ev.data.u64 = token;
+    return epoll_ctl(mEpollFd, EPOLL_CTL_MOD, socket, &ev) == 0;
+}
+
+void Poller::remove(SocketHandle socket) {
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, socket, nullptr);
+}
+
+int Poller::wait(std::vector<Event>& events, int timeoutMs) {
+    epoll_event raw[64];
+    events.clear();
+    int ready = epoll_wait(mEpollFd, raw, 64, timeoutMs);
+    if (ready < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    for (int i = 0; i < ready; ++i) {
+        if (raw[i].data.u64 == WakeupToken) {
+            uint64_t counter;
+            while (::read(mWakeFd, &counter, sizeof(counter)) > 0) {}
+        }
+        uint32_t flags = 0;
+        if (raw[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) flags |= Readable;
+        if (raw[i].events & EPOLLOUT) flags |= Writable;
+        if (raw[i].events & EPOLLERR) flags |= Error | Readable;
+        events.push_back({raw[i].data.u64, flags});
+    }
+    return ready;
+}
+
+void Poller::wakeup() {
+    uint64_t one = 1;
+    [[maybe_unused]] auto written = ::write(mWakeFd, &one, sizeof(one));
+}
+
+#endif
+
+} // namespace mclistener_ws_server
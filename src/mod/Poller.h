@@ -0,0 +1,70 @@
+#pragma once
+
+#include "mod/Socket.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace mclistener_ws_server {
+
+/**
+ * 基于就绪通知的 socket 多路复用器
+ * Linux 下使用 epoll，Windows 下使用 WSAPoll
+ * 除 wakeup() 外，所有方法只能在事件循环线程中调用
+ */
+class Poller {
+public:
+    // 关注 / 就绪事件标志
+    enum : uint32_t {
+        Readable = 1u << 0,
+        Writable = 1u << 1,
+        Error    = 1u << 2,
+    };
+
+    struct Event {
+        uint64_t token;
+        uint32_t events;
+    };
+
+    // wakeup() 产生的事件使用的保留 token
+    static constexpr uint64_t WakeupToken = ~uint64_t{0};
+
+    Poller() = default;
+    ~Poller();
+
+    Poller(const Poller&) = delete;
+    Poller& operator=(const Poller&) = delete;
+
+    // 创建底层句柄和唤醒通道
+    bool open();
+
+    // 释放底层句柄
+    void close();
+
+    // 注册 / 修改 / 移除 socket 的关注事件
+    bool add(SocketHandle socket, uint64_t token, uint32_t interest);
+    bool modify(SocketHandle socket, uint64_t token, uint32_t interest);
+    void remove(SocketHandle socket);
+
+    // 等待事件，超时返回 0，出错返回 -1
+    int wait(std::vector<Event>& events, int timeoutMs);
+
+    // 从任意线程唤醒正在 wait() 的事件循环 (线程安全)
+    void wakeup();
+
+private:
+#ifdef _WIN32
+    // WSAPoll 需要自行维护 pollfd 数组，唤醒通过本地回环 UDP socket 实现
+    std::vector<WSAPOLLFD> mPollFds;
+    std::vector<uint64_t> mTokens;
+    std::unordered_map<SocketHandle, size_t> mIndex;
+    SocketHandle mWakeSocket = InvalidSocket;
+    sockaddr_in mWakeAddr{};
+#else
+    int mEpollFd = -1;
+    int mWakeFd = -1;
+#endif
+};
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,84 @@
+#include "mod/SendQueue.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace mclistener_ws_server {
+
+OverflowPolicy parseOverflowPolicy(const std::string& policyStr) {
+    std::string lower = policyStr;
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c){ return std::tolower(c); });
+
+    if (lower == "drop_newest") return OverflowPolicy::DropNewest;
+    if (lower == "disconnect") return OverflowPolicy::Disconnect;
+
+    return OverflowPolicy::DropOldest; // 默认 drop_oldest
+}
+
+SendQueue::SendQueue(size_t capacity, OverflowPolicy policy, Counter* droppedCounter)
+    : mPolicy(policy), mDroppedCounter(droppedCounter), mRing(std::max<size_t>(capacity, 1)) {
+}
+
+bool SendQueue::push(FrameRef frame) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mDisconnect) {
+        return false;
+    }
+
+    if (mSize == mRing.size()) {
+        switch (mPolicy) {
+        case OverflowPolicy::DropNewest:
+            ++mDropped;
+            if (mDroppedCounter) {
+                mDroppedCounter->add();
+            }
+            return true;
+        case OverflowPolicy::Disconnect:
+            mDisconnect = true;
+            return false;
+        case OverflowPolicy::DropOldest:
+            mBytes -= mRing[mHead]->size();
+            mRing[mHead].reset();
+            mHead = (mHead + 1) % mRing.size();
+            --mSize;
+            ++mDropped;
+            if (mDroppedCounter) {
+                mDroppedCounter->add();
+            }
+            break;
+        }
+    }
+
+    mBytes += frame->size();
+    mRing[(mHead + mSize) % mRing.size()] = std::move(frame);
+    ++mSize;
+    return true;
+}
+
+size_t SendQueue::popAll(std::vector<FrameRef>& out) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    size_t count = mSize;
+    while (mSize > 0) {
+        out.push_back(std::move(mRing[mHead]));
+        mHead = (mHead + 1) % mRing.size();
+        --mSize;
+    }
+    mHead = 0;
+    mBytes = 0;
+    return count;
+}
+
+size_t SendQueue::size() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSize;
+}
+
+size_t SendQueue::bytes() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mBytes;
+}
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "mod/Frame.h"
+#include "mod/Metrics.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mclistener_ws_server {
+
+// 发送队列溢出策略
+enum class OverflowPolicy {
+    DropOldest, // 丢弃队列中最旧的帧
+    DropNewest, // 丢弃新到的帧
+    Disconnect, // 断开该客户端
+};
+
+// 将配置字符串转换为溢出策略，无法识别时返回 DropOldest
+OverflowPolicy parseOverflowPolicy(const std::string& policyStr);
+
+/**
+ * 单个客户端的有界发送队列
+ * 由广播方 (任意线程) 入队，由事件循环线程出队并写入 socket
+ * 队列是预先分配好的环形数组，入队只涉及一次短暂加锁和引用计数递增，
+ * 不分配内存，也绝不接触 socket
+ */
+class SendQueue {
+public:
+    // droppedCounter 不为空时，溢出丢弃的帧同时计入该计数器
+    SendQueue(size_t capacity, OverflowPolicy policy, Counter* droppedCounter = nullptr);
+
+    SendQueue(const SendQueue&) = delete;
+    SendQueue& operator=(const SendQueue&) = delete;
+
+    // 入队一帧，返回 false 表示按 Disconnect 策略需要断开该客户端
+    bool push(FrameRef frame);
+
+    // 取出队列中的所有帧，按顺序追加到 out，返回取出的帧数
+    size_t popAll(std::vector<FrameRef>& out);
+
+    // 当前排队的帧数
+    size_t size() const;
+
+    // 当前排队帧的总字节数
+    size_t bytes() const;
+
+    // 因溢出被丢弃的帧数
+    uint64_t droppedCount() const { return mDropped; }
+
+    // 是否已按 Disconnect 策略请求断开
+    bool shouldDisconnect() const { return mDisconnect; }
+
+private:
+    const OverflowPolicy mPolicy;
+    Counter* mDroppedCounter;
+
+    mutable std::mutex mMutex;
+    std::vector<FrameRef> mRing;
+    size_t mHead = 0;
+    size_t mSize = 0;
+    size_t mBytes = 0;
+
+    std::atomic<uint64_t> mDropped{0};
+    std::atomic<bool> mDisconnect{false};
+};
+
+} // namespace mclistener_ws_server
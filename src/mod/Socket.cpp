@@ -0,0 +1,179 @@
+#include "mod/Socket.h"
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace mclistener_ws_server {
+
+bool socketStartup(int& error) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    error = WSAStartup(MAKEWORD(2, 2), &wsaData);
+    return error == 0;
+#else
+    error = 0;
+    return true;
+#endif
+}
+
+void socketCleanup() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+void closeSocket(SocketHandle socket) {
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    ::close(socket);
+#endif
+}
+
+bool setNonBlocking(SocketHandle socket) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    return flags != -1 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+bool setNoDelay(SocketHandle socket, bool enable) {
+    int value = enable ? 1 : 0;
+    return setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&value, sizeof(value)) == 0;
+}
+
+int lastSocketError() {
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+bool isWouldBlock(int error) {
+#ifdef _WIN32
+    return error == WSAEWOULDBLOCK;
+#else
+    return error == EWOULDBLOCK || error == EAGAIN;
+#endif
+}
+
+int64_t sendSome(SocketHandle socket, const void* data, size_t length) {
+#ifdef _WIN32
+    int sent = send(socket, static_cast<const char*>(data), static_cast<int>(length), 0);
+#else
+    ssize_t sent = ::send(socket, data, length, MSG_NOSIGNAL);
+#endif
+    if (sent < 0) {
+        return isWouldBlock(lastSocketError()) ? 0 : -1;
+    }
+    return static_cast<int64_t>(sent);
+}
+
+int64_t sendVector(SocketHandle socket, const IoSlice* slices, size_t count) {
+    if (count > MaxIoSlices) {
+        count = MaxIoSlices;
+    }
+#ifdef _WIN32
+    WSABUF buffers[MaxIoSlices];
+    for (size_t i = 0; i < count; ++i) {
+        buffers[i].buf = static_cast<CHAR*>(const_cast<void*>(slices[i].data));
+        buffers[i].len = static_cast<ULONG>(slices[i].length);
+    }
+    DWORD sent = 0;
+    if (WSASend(socket, buffers, static_cast<DWORD>(count), &sent, 0, nullptr, nullptr) != 0) {
+        return isWouldBlock(lastSocketError()) ? 0 : -1;
+    }
+    return static_cast<int64_t>(sent);
+#else
+    iovec buffers[MaxIoSlices];
+    for (size_t i = 0; i < count; ++i) {
+        buffers[i].iov_base = const_cast<void*>(slices[i].data);
+        buffers[i].iov_len  = slices[i].length;
+    }
+    msghdr msg{};
+    msg.msg_iov    = buffers;
+    msg.msg_iovlen = count;
+    ssize_t sent   = ::sendmsg(socket, &msg, MSG_NOSIGNAL);
+    if (sent < 0) {
+        return isWouldBlock(lastSocketError()) ? 0 : -1;
+    }
+    return static_cast<int64_t>(sent);
+#endif
+}
+
+int64_t recvSome(SocketHandle socket, void* data, size_t length) {
+#ifdef _WIN32
+    int received = recv(socket, static_cast<char*>(data), static_cast<int>(length), 0);
+#else
+    ssize_t received = ::recv(socket, data, length, 0);
+#endif
+    return received < 0 ? -1 : static_cast<int64_t>(received);
+}
+
+std::string formatPeerAddress(const sockaddr_in& addr) {
+    char ip[INET_ADDRSTRLEN] = {0};
+    inet_ntop(AF_INET, &addr.sin_addr, ip, INET_ADDRSTRLEN);
+    return std::string(ip) + ":" + std::to_string(ntohs(addr.sin_port));
+}
+
+bool isLoopbackAddress(const sockaddr_in& addr) {
+    return addr.sin_family == AF_INET && (ntohl(addr.sin_addr.s_addr) >> 24) == 127;
+}
+
+SocketHandle listenLocal(const std::string& path, int& error) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+#ifdef _WIN32
+        error = WSAENAMETOOLONG;
+#else
+        error = ENAMETOOLONG;
+#endif
+        return InvalidSocket;
+    }
+    std::memcpy(addr.sun_path, path.data(), path.size());
+
+    removeLocalSocketFile(path);
+
+    SocketHandle listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener == InvalidSocket) {
+        error = lastSocketError();
+        return InvalidSocket;
+    }
+    if (bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, SOMAXCONN) != 0
+        || !setNonBlocking(listener)) {
+        error = lastSocketError();
+        closeSocket(listener);
+        return InvalidSocket;
+    }
+    error = 0;
+    return listener;
+}
+
+void removeLocalSocketFile(const std::string& path) {
+#ifdef _WIN32
+    // Windows 下 AF_UNIX socket 文件是重解析点
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    if (attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+        DeleteFileA(path.c_str());
+    }
+#else
+    struct stat info{};
+    if (lstat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+        ::unlink(path.c_str());
+    }
+#endif
+}
+
+} // namespace mclistener_ws_server
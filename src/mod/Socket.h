@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+// Windows headers
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#include <afunix.h>
+
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+namespace mclistener_ws_server {
+
+/**
+ * 平台 socket 的最小抽象
+ * Windows 下为 Winsock，其他平台为 POSIX socket，便于在 Linux 上无头测试
+ */
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+inline constexpr SocketHandle InvalidSocket = INVALID_SOCKET;
+#else
+using SocketHandle = int;
+inline constexpr SocketHandle InvalidSocket = -1;
+#endif
+
+// 初始化 / 清理 socket 库 (Windows 下对应 WSAStartup / WSACleanup)
+bool socketStartup(int& error);
+void socketCleanup();
+
+// 关闭 socket
+void closeSocket(SocketHandle socket);
+
+// 设置为非阻塞模式
+bool setNonBlocking(SocketHandle socket);
+
+// 设置 TCP_NODELAY (关闭 / 开启 Nagle 算法)
+bool setNoDelay(SocketHandle socket, bool enable);
+
+// 获取最近一次 socket 错误码
+int lastSocketError();
+
+// 错误码是否表示 "暂时不可读写" (EWOULDBLOCK / WSAEWOULDBLOCK)
+bool isWouldBlock(int error);
+
+// 非阻塞发送，返回已发送字节数；0 表示需要等待可写，-1 表示出错
+int64_t sendSome(SocketHandle socket, const void* data, size_t length);
+
+// 非阻塞接收，返回接收字节数；0 表示对端关闭，-1 表示出错或暂无数据 (用 lastSocketError 区分)
+int64_t recvSome(SocketHandle socket, void* data, size_t length);
+
+// 分散写的一个分段
+struct IoSlice {
+    const void* data;
+    size_t      length;
+};
+
+// 单次分散写允许的最大分段数
+inline constexpr size_t MaxIoSlices = 64;
+
+// 非阻塞分散写 (writev / WSASend)，返回值语义同 sendSome
+int64_t sendVector(SocketHandle socket, const IoSlice* slices, size_t count);
+
+// 将地址格式化为 "ip:port"
+std::string formatPeerAddress(const sockaddr_in& addr);
+
+// 是否为回环地址 (127.0.0.0/8)
+bool isLoopbackAddress(const sockaddr_in& addr);
+
+// 在 path 上创建非阻塞的 Unix 域监听 socket (Windows 10 1803 起同样支持 AF_UNIX)
+// 上次未正常退出残留的 socket 文件会先被删除；失败时返回 InvalidSocket，错误码写入 error
+SocketHandle listenLocal(const std::string& path, int& error);
+
+// 删除 Unix 域 socket 文件，path 不是 socket 文件时不做任何事
+void removeLocalSocketFile(const std::string& path);
+
+} // namespace mclistener_ws_server
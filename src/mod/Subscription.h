@@ -0,0 +1,42 @@
+#pragma once
+
+#include "mod/OutboundEvent.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mclistener_ws_server {
+
+// 事件类型在订阅位掩码中对应的位
+inline constexpr uint32_t topicBit(EventType type) {
+    return 1u << static_cast<unsigned>(type);
+}
+
+inline constexpr uint32_t AllTopics = (1u << EventTypeCount) - 1;
+
+// 未指定事件类型时接收的主题: 遥测数据量大，需要显式订阅
+inline constexpr uint32_t DefaultTopics = AllTopics & ~topicBit(EventType::Telemetry);
+
+/**
+ * 客户端通过 subscribe 消息设置的订阅
+ * 广播扇出时先比较位掩码，再按玩家名过滤；未发送 subscribe 的客户端接收 DefaultTopics 中的事件
+ */
+struct Subscription {
+    uint32_t topics = DefaultTopics;
+    std::vector<std::string> players; // 已排序，为空表示所有玩家
+
+    // player 为空表示消息不属于单个玩家 (如遥测)，不按玩家过滤
+    bool wantsPlayer(std::string_view player) const {
+        return players.empty() || player.empty() || std::binary_search(players.begin(), players.end(), player);
+    }
+
+    // topic 为 topicBit() 的结果
+    bool matches(uint32_t topic, std::string_view player) const {
+        return (topics & topic) != 0 && wantsPlayer(player);
+    }
+};
+
+} // namespace mclistener_ws_server
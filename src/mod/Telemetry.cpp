@@ -0,0 +1,166 @@
+#include "mod/Telemetry.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mclistener_ws_server {
+
+// 变化记录中的字段位
+static constexpr uint8_t FIELD_X         = 0x01;
+static constexpr uint8_t FIELD_Y         = 0x02;
+static constexpr uint8_t FIELD_Z         = 0x04;
+static constexpr uint8_t FIELD_DIMENSION = 0x08;
+static constexpr uint8_t FIELD_HEALTH    = 0x10;
+
+static void writeVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static void writeSigned(std::string& out, int64_t value) {
+    writeVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+static int32_t quantize(float value) {
+    float scaled = std::round(value * TelemetryPositionScale);
+    return static_cast<int32_t>(std::clamp(scaled, -2147483648.0f, 2147483520.0f));
+}
+
+void TelemetrySnapshot::reserve(size_t count) {
+    names.reserve(count);
+    x.reserve(count);
+    y.reserve(count);
+    z.reserve(count);
+    dimension.reserve(count);
+    health.reserve(count);
+}
+
+void TelemetrySnapshot::add(std::string name, float px, float py, float pz, int32_t dim, int32_t hp) {
+    names.push_back(std::move(name));
+    x.push_back(quantize(px));
+    y.push_back(quantize(py));
+    z.push_back(quantize(pz));
+    dimension.push_back(dim);
+    health.push_back(hp);
+}
+
+TelemetryEncoder::TelemetryEncoder(uint32_t keyframeInterval) : mKeyframeInterval(std::max<uint32_t>(keyframeInterval, 1)) {}
+
+void TelemetryEncoder::writeHeader(std::string& out, bool keyframe) const {
+    out.push_back(static_cast<char>(keyframe ? KeyframeFlag : 0));
+    writeVarint(out, mSample);
+    writeVarint(out, mTick);
+}
+
+void TelemetryEncoder::writeRecord(std::string& out, uint32_t slot, const Tracked& entry) {
+    writeVarint(out, slot);
+    writeVarint(out, entry.name.size());
+    out.append(entry.name);
+    writeSigned(out, entry.x);
+    writeSigned(out, entry.y);
+    writeSigned(out, entry.z);
+    writeSigned(out, entry.dimension);
+    writeSigned(out, entry.health);
+}
+
+bool TelemetryEncoder::encode(const TelemetrySnapshot& snapshot, std::string& out) {
+    ++mSample;
+    mTick = snapshot.tick;
+    mAdded.clear();
+    mChanged.clear();
+    mRemoved.clear();
+
+    size_t addedCount = 0;
+    size_t changedCount = 0;
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        auto [it, inserted] = mSlotByName.try_emplace(snapshot.names[i], 0);
+        if (inserted) {
+            // 本次采样中离开的玩家的槽位在循环结束后才回收，不会被同一次采样复用
+            if (!mFreeSlots.empty()) {
+                it->second = mFreeSlots.back();
+                mFreeSlots.pop_back();
+            } else {
+                it->second = static_cast<uint32_t>(mTracked.size());
+                mTracked.emplace_back();
+            }
+        }
+        const uint32_t slot = it->second;
+        Tracked& entry = mTracked[slot];
+
+        if (inserted) {
+            entry.name = snapshot.names[i];
+            entry.x = snapshot.x[i];
+            entry.y = snapshot.y[i];
+            entry.z = snapshot.z[i];
+            entry.dimension = snapshot.dimension[i];
+            entry.health = snapshot.health[i];
+            writeRecord(mAdded, slot, entry);
+            ++addedCount;
+        } else if (entry.seenSample != mSample) {
+            uint8_t mask = (snapshot.x[i] != entry.x ? FIELD_X : 0) | (snapshot.y[i] != entry.y ? FIELD_Y : 0)
+                         | (snapshot.z[i] != entry.z ? FIELD_Z : 0)
+                         | (snapshot.dimension[i] != entry.dimension ? FIELD_DIMENSION : 0)
+                         | (snapshot.health[i] != entry.health ? FIELD_HEALTH : 0);
+            if (mask != 0) {
+                writeVarint(mChanged, slot);
+                mChanged.push_back(static_cast<char>(mask));
+                if (mask & FIELD_X) writeSigned(mChanged, int64_t{snapshot.x[i]} - entry.x);
+                if (mask & FIELD_Y) writeSigned(mChanged, int64_t{snapshot.y[i]} - entry.y);
+                if (mask & FIELD_Z) writeSigned(mChanged, int64_t{snapshot.z[i]} - entry.z);
+                if (mask & FIELD_DIMENSION) writeSigned(mChanged, int64_t{snapshot.dimension[i]} - entry.dimension);
+                if (mask & FIELD_HEALTH) writeSigned(mChanged, int64_t{snapshot.health[i]} - entry.health);
+                entry.x = snapshot.x[i];
+                entry.y = snapshot.y[i];
+                entry.z = snapshot.z[i];
+                entry.dimension = snapshot.dimension[i];
+                entry.health = snapshot.health[i];
+                ++changedCount;
+            }
+        }
+        // 同一玩家在一次采样中出现多次时只取第一条
+        entry.seenSample = mSample;
+    }
+
+    for (uint32_t slot = 0; slot < mTracked.size(); ++slot) {
+        Tracked& entry = mTracked[slot];
+        if (!entry.name.empty() && entry.seenSample != mSample) {
+            mSlotByName.erase(entry.name);
+            entry.name.clear();
+            mRemoved.push_back(slot);
+            mFreeSlots.push_back(slot);
+        }
+    }
+
+    out.clear();
+    if ((mSample - 1) % mKeyframeInterval == 0) {
+        encodeKeyframe(out);
+        return true;
+    }
+
+    writeHeader(out, false);
+    writeVarint(out, mRemoved.size());
+    for (uint32_t slot : mRemoved) {
+        writeVarint(out, slot);
+    }
+    writeVarint(out, addedCount);
+    out.append(mAdded);
+    writeVarint(out, changedCount);
+    out.append(mChanged);
+    return false;
+}
+
+void TelemetryEncoder::encodeKeyframe(std::string& out) const {
+    out.clear();
+    writeHeader(out, true);
+    writeVarint(out, mSlotByName.size());
+    for (uint32_t slot = 0; slot < mTracked.size(); ++slot) {
+        if (!mTracked[slot].name.empty()) {
+            writeRecord(out, slot, mTracked[slot]);
+        }
+    }
+}
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mclistener_ws_server {
+
+// 坐标量化精度: 1/100 方块
+inline constexpr float TelemetryPositionScale = 100.0f;
+
+/**
+ * 游戏线程一次采样得到的所有玩家状态 (结构数组)
+ * 坐标在采样时即量化为整数，工作线程只做整数比较和编码
+ */
+struct TelemetrySnapshot {
+    uint64_t tick = 0;
+    std::vector<std::string> names;
+    std::vector<int32_t> x;
+    std::vector<int32_t> y;
+    std::vector<int32_t> z;
+    std::vector<int32_t> dimension;
+    std::vector<int32_t> health;
+
+    size_t size() const { return names.size(); }
+
+    void reserve(size_t count);
+
+    // 追加一个玩家，坐标按 TelemetryPositionScale 量化
+    void add(std::string name, float px, float py, float pz, int32_t dim, int32_t hp);
+};
+
+/**
+ * 遥测流的增量编码器，只由 EventDispatcher 的工作线程访问
+ *
+ * 每个玩家在首次出现时分配一个小整数槽位，离开后槽位回收复用。
+ * 每次采样相对上一次采样编码: 离开的槽位、新出现的玩家 (完整记录)、
+ * 以及发生变化的玩家 (字段位掩码 + 各字段差值)；每 keyframeInterval 次采样输出一次完整的关键帧。
+ * 所有整数为 LEB128 varint，有符号数先做 zigzag，格式见 prod.md
+ */
+class TelemetryEncoder {
+public:
+    // 负载首字节的标志位
+    static constexpr uint8_t KeyframeFlag = 0x01;
+
+    explicit TelemetryEncoder(uint32_t keyframeInterval);
+
+    // 编码一次采样，返回 true 表示输出的是关键帧
+    bool encode(const TelemetrySnapshot& snapshot, std::string& out);
+
+    // 按最近一次 encode() 之后的状态编码关键帧，供尚未同步的订阅者使用
+    void encodeKeyframe(std::string& out) const;
+
+    // 已编码的采样数
+    uint64_t sampleCount() const { return mSample; }
+
+private:
+    struct Tracked {
+        std::string name; // 为空表示槽位空闲
+        int32_t x = 0;
+        int32_t y = 0;
+        int32_t z = 0;
+        int32_t dimension = 0;
+        int32_t health = 0;
+        uint64_t seenSample = 0;
+    };
+
+    void writeHeader(std::string& out, bool keyframe) const;
+    static void writeRecord(std::string& out, uint32_t slot, const Tracked& entry);
+
+    uint32_t mKeyframeInterval;
+    uint64_t mSample = 0;
+    uint64_t mTick = 0;
+    std::vector<Tracked> mTracked; // 下标即槽位
+    std::unordered_map<std::string, uint32_t> mSlotByName;
+    std::vector<uint32_t> mFreeSlots;
+
+    // 编码过程中复用的缓冲区
+    std::string mAdded;
+    std::string mChanged;
+    std::vector<uint32_t> mRemoved;
+};
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,63 @@
+#include "mod/TimerWheel.h"
+
+#include <algorithm>
+
+namespace mclistener_ws_server {
+
+TimerWheel::TimerWheel(std::chrono::milliseconds resolution, size_t slotCount)
+    : mResolution(std::max(resolution, std::chrono::milliseconds(1))),
+      mSlots(std::max<size_t>(slotCount, 1)),
+      mStart(Clock::now()) {}
+
+void TimerWheel::schedule(uint64_t id, Clock::time_point when) {
+    // 向上取整到时间片，且至少是下一个时间片
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(when - mStart).count();
+    uint64_t tick = elapsed <= 0 ? 0 : static_cast<uint64_t>((elapsed + mResolution.count() - 1) / mResolution.count());
+    tick = std::max(tick, mCurrentTick + 1);
+
+    uint64_t delta = tick - mCurrentTick;
+    mSlots[tick % mSlots.size()].push_back(Entry{id, (delta - 1) / mSlots.size()});
+    ++mCount;
+}
+
+void TimerWheel::advance(Clock::time_point now, std::vector<uint64_t>& expired) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - mStart).count();
+    if (elapsed <= 0) {
+        return;
+    }
+    uint64_t target = static_cast<uint64_t>(elapsed / mResolution.count());
+
+    // 没有定时器时直接跳到当前时间片
+    if (mCount == 0) {
+        mCurrentTick = std::max(mCurrentTick, target);
+        return;
+    }
+
+    while (mCurrentTick < target) {
+        ++mCurrentTick;
+        auto& slot = mSlots[mCurrentTick % mSlots.size()];
+        size_t kept = 0;
+        for (auto& entry : slot) {
+            if (entry.rounds == 0) {
+                expired.push_back(entry.id);
+                --mCount;
+            } else {
+                --entry.rounds;
+                slot[kept++] = entry;
+            }
+        }
+        slot.resize(kept);
+    }
+}
+
+int TimerWheel::nextTimeoutMs(Clock::time_point now) const {
+    if (mCount == 0) {
+        return -1;
+    }
+    auto next = mStart + mResolution * static_cast<int64_t>(mCurrentTick + 1);
+    // 向上取整，避免在时间片边界前以 0 超时空转
+    auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(next - now).count();
+    return static_cast<int>(std::max<int64_t>((remaining + 999) / 1000, 0));
+}
+
+} // namespace mclistener_ws_server
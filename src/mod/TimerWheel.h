@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mclistener_ws_server {
+
+/**
+ * 单线程哈希时间轮
+ * 由事件循环线程驱动所有连接的心跳和超时检查，不为每个连接创建线程或系统定时器。
+ *
+ * 每个槽位对应 resolution 长的时间片，超过一圈的定时器记录剩余圈数；
+ * 定时器不支持取消，调用方在到期时自行判断是否仍然有效 (例如连接已关闭则忽略)
+ */
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TimerWheel(std::chrono::milliseconds resolution, size_t slotCount);
+
+    // 在 when 时刻 (按 resolution 向上取整) 触发 id
+    void schedule(uint64_t id, Clock::time_point when);
+
+    // 推进到 now，把到期的 id 追加到 expired
+    void advance(Clock::time_point now, std::vector<uint64_t>& expired);
+
+    // 距离下一个槽位到期的毫秒数，没有定时器时返回 -1
+    int nextTimeoutMs(Clock::time_point now) const;
+
+    // 当前定时器数量
+    size_t size() const { return mCount; }
+
+private:
+    struct Entry {
+        uint64_t id;
+        uint64_t rounds; // 还需要经过的整圈数
+    };
+
+    std::chrono::milliseconds mResolution;
+    std::vector<std::vector<Entry>> mSlots;
+    Clock::time_point mStart;
+    uint64_t mCurrentTick = 0; // 已处理到的时间片序号
+    size_t mCount = 0;
+};
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace mclistener_ws_server {
+
+// 令牌桶参数: 平均每 interval 补充一个令牌，最多积攒 burst 个
+struct RateLimit {
+    int64_t intervalNanos = 0; // 0 表示不限制
+    int64_t burst = 1;
+
+    bool enabled() const { return intervalNanos > 0; }
+
+    // 由 "每分钟条数 + 突发上限" 的配置构造，ratePerMinute <= 0 表示不限制
+    static RateLimit perMinute(int ratePerMinute, int burst) {
+        RateLimit limit;
+        if (ratePerMinute > 0) {
+            limit.intervalNanos = int64_t{60'000'000'000} / ratePerMinute;
+            limit.burst = std::max(burst, 1);
+        }
+        return limit;
+    }
+};
+
+/**
+ * 无锁令牌桶 (GCRA 形式)
+ * 整个状态只有一个原子的 "理论到达时间"，tryAcquire() 用一次 CAS 推进，
+ * 任意线程可以并发调用；不分配内存，参数由调用方传入，多个桶可以共享同一份 RateLimit
+ */
+class TokenBucket {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // 取一个令牌，返回 false 表示已超出速率
+    bool tryAcquire(const RateLimit& limit, Clock::time_point now = Clock::now()) {
+        if (!limit.enabled()) {
+            return true;
+        }
+        const int64_t t = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+        int64_t tat = mTat.load(std::memory_order_relaxed);
+        while (true) {
+            int64_t next = std::max(tat, t) + limit.intervalNanos;
+            if (next - t > limit.burst * limit.intervalNanos) {
+                return false;
+            }
+            if (mTat.compare_exchange_weak(tat, next, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+
+    // 桶是否已回满 (之后的调用等同于全新的桶)，用于清理长时间不活动的桶
+    bool idle(Clock::time_point now = Clock::now()) const {
+        return mTat.load(std::memory_order_relaxed)
+            <= std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+    }
+
+private:
+    std::atomic<int64_t> mTat{0};
+};
+
+} // namespace mclistener_ws_server
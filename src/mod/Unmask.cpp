@@ -0,0 +1,154 @@
+#include "mod/Unmask.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MCLWS_UNMASK_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC / Clang 需要为单个函数打开 AVX2 指令集，MSVC 可以直接使用内建函数
+#if defined(MCLWS_UNMASK_X86) && (defined(__GNUC__) || defined(__clang__))
+#define MCLWS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MCLWS_TARGET_AVX2
+#endif
+
+namespace mclistener_ws_server {
+
+// 按起始偏移旋转掩码，使 key 的第 0 字节对应 src[0]
+static uint32_t rotatedKey(const unsigned char mask[4], size_t maskOffset) {
+    unsigned char rotated[4];
+    for (size_t i = 0; i < 4; ++i) {
+        rotated[i] = mask[(maskOffset + i) & 3];
+    }
+    uint32_t key;
+    std::memcpy(&key, rotated, 4);
+    return key;
+}
+
+// 每次处理 8 字节，剩余部分逐字节处理；处理的块都是 4 的倍数，掩码相位保持不变
+static void unmaskScalar(char* dst, const char* src, size_t length, uint32_t key) {
+    uint64_t key64 = (static_cast<uint64_t>(key) << 32) | key;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t value;
+        std::memcpy(&value, src + i, 8);
+        value ^= key64;
+        std::memcpy(dst + i, &value, 8);
+    }
+
+    unsigned char keyBytes[4];
+    std::memcpy(keyBytes, &key, 4);
+    for (; i < length; ++i) {
+        dst[i] = static_cast<char>(src[i] ^ keyBytes[i & 3]);
+    }
+}
+
+#ifdef MCLWS_UNMASK_X86
+
+static void unmaskSse2(char* dst, const char* src, size_t length, uint32_t key) {
+    const __m128i key128 = _mm_set1_epi32(static_cast<int>(key));
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(value, key128));
+    }
+    unmaskScalar(dst + i, src + i, length - i, key);
+}
+
+MCLWS_TARGET_AVX2 static void unmaskAvx2(char* dst, const char* src, size_t length, uint32_t key) {
+    const __m256i key256 = _mm256_set1_epi32(static_cast<int>(key));
+    size_t i = 0;
+    for (; i + 64 <= length; i += 64) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(a, key256));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 32), _mm256_xor_si256(b, key256));
+    }
+    for (; i + 32 <= length; i += 32) {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(value, key256));
+    }
+    unmaskSse2(dst + i, src + i, length - i, key);
+}
+
+static bool cpuSupportsAvx2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    // 需要 CPU 支持 AVX 且操作系统保存 YMM 寄存器状态
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // MCLWS_UNMASK_X86
+
+bool isUnmaskKernelSupported(UnmaskKernel kernel) {
+    switch (kernel) {
+    case UnmaskKernel::Scalar:
+        return true;
+#ifdef MCLWS_UNMASK_X86
+    case UnmaskKernel::Sse2:
+        // x86-64 总是支持 SSE2；32 位 MSVC 默认也以 SSE2 为基线
+        return true;
+    case UnmaskKernel::Avx2: {
+        static const bool supported = cpuSupportsAvx2();
+        return supported;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+UnmaskKernel selectedUnmaskKernel() {
+    static const UnmaskKernel kernel = isUnmaskKernelSupported(UnmaskKernel::Avx2) ? UnmaskKernel::Avx2
+                                     : isUnmaskKernelSupported(UnmaskKernel::Sse2) ? UnmaskKernel::Sse2
+                                                                                   : UnmaskKernel::Scalar;
+    return kernel;
+}
+
+void unmaskPayloadWith(UnmaskKernel kernel, char* dst, const char* src, size_t length,
+                       const unsigned char mask[4], size_t maskOffset) {
+    uint32_t key = rotatedKey(mask, maskOffset);
+    if (!isUnmaskKernelSupported(kernel)) {
+        kernel = UnmaskKernel::Scalar;
+    }
+
+    switch (kernel) {
+#ifdef MCLWS_UNMASK_X86
+    case UnmaskKernel::Avx2:
+        unmaskAvx2(dst, src, length, key);
+        return;
+    case UnmaskKernel::Sse2:
+        unmaskSse2(dst, src, length, key);
+        return;
+#endif
+    default:
+        unmaskScalar(dst, src, length, key);
+        return;
+    }
+}
+
+void unmaskPayload(char* dst, const char* src, size_t length, const unsigned char mask[4], size_t maskOffset) {
+    unmaskPayloadWith(selectedUnmaskKernel(), dst, src, length, mask, maskOffset);
+}
+
+} // namespace mclistener_ws_server
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+namespace mclistener_ws_server {
+
+// 解掩码实现，运行时按 CPU 支持情况选择最快的一种
+enum class UnmaskKernel { Scalar, Sse2, Avx2 };
+
+/**
+ * 对客户端帧负载按 4 字节掩码异或 (RFC 6455 5.3)
+ * dst 与 src 可以是同一块缓冲区 (原地解掩码)，但不能部分重叠
+ * maskOffset 为 src[0] 在掩码中的位置 (0-3)，同一帧分多次处理时由调用方累加
+ */
+void unmaskPayload(char* dst, const char* src, size_t length, const unsigned char mask[4], size_t maskOffset);
+
+// 使用指定实现解掩码，供基准测试对比和校验；实现不受支持时退回标量版本
+void unmaskPayloadWith(UnmaskKernel kernel, char* dst, const char* src, size_t length,
+                       const unsigned char mask[4], size_t maskOffset);
+
+// 当前 CPU 是否支持指定实现
+bool isUnmaskKernelSupported(UnmaskKernel kernel);
+
+// unmaskPayload() 实际使用的实现
+UnmaskKernel selectedUnmaskKernel();
+
+} // namespace mclistener_ws_server
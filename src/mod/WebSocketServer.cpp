@@ -1,17 +1,243 @@
 #include "mod/WebSocketServer.h"
-#include "mod/MclistenerWsServerMod.h"
+#include "mod/Handshake.h"
+#include "mod/InboundScanner.h"
+#include "mod/JsonWriter.h"
 
+#include <nlohmann/json.hpp>
 #include <sstream>
 #include <algorithm>
+#include <cctype>
 #include <cstring>
+#include <optional>
 
 namespace mclistener_ws_server {
 
-// WebSocket GUID (RFC 6455)
-static const char* WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+// 监听 socket 在 poller 中使用的 token，连接 id 从 1 开始
+static constexpr uint64_t LISTENER_TOKEN = 0;
+static constexpr uint64_t LOCAL_LISTENER_TOKEN = Poller::WakeupToken - 1;
 
-WebSocketServer::WebSocketServer(const std::string& host, int port, MclistenerWsServerMod* mod)
-    : mHost(host), mPort(port), mMod(mod) {
+// 握手请求最大长度
+static constexpr size_t MAX_HANDSHAKE_SIZE = 4096;
+
+// 本机连接协议名一行的最大长度
+static constexpr size_t MAX_LOCAL_PROTOCOL_LINE = 64;
+
+// 单条消息最大长度 (1MB)，分片消息按总长度计算，压缩消息按解压后的长度计算
+static constexpr size_t MAX_PAYLOAD_SIZE = 1024 * 1024;
+
+// 每次 recv 使用的栈上缓冲区大小
+static constexpr size_t READ_CHUNK_SIZE = 4096;
+
+// 单次可读事件最多读取的字节数，剩余数据留给下一轮事件循环 (水平触发)
+static constexpr size_t MAX_READ_PER_EVENT = 64 * 1024;
+
+// 时间轮的时间片长度和槽位数 (一圈 64 秒)
+static constexpr std::chrono::milliseconds TIMER_RESOLUTION{250};
+static constexpr size_t TIMER_SLOTS = 256;
+
+// 开启慢消费者检测时，发送积压的采样间隔
+static constexpr std::chrono::milliseconds SLOW_CONSUMER_SAMPLE_INTERVAL{1000};
+
+// 发出关闭帧后等待写完的最长时间，对方不读取数据时直接断开
+static constexpr std::chrono::milliseconds CLOSE_TIMEOUT{5000};
+
+// 没有定时器时事件循环的最长等待时间
+static constexpr int MAX_POLL_TIMEOUT_MS = 1000;
+
+// 按连接的帧格式构造控制帧
+static FrameRef makeControlFrame(bool local, unsigned char opcode, std::string payload) {
+    return local ? OutboundFrame::lengthPrefixed(opcode, std::move(payload))
+                 : OutboundFrame::control(opcode, std::move(payload));
+}
+
+// 对端关闭帧中可以原样回应的状态码 (RFC 6455 §7.4)，
+// 1004-1006 和 1015 是保留值、不能出现在关闭帧中，1016-2999 尚未分配
+static bool isValidCloseCode(uint16_t code) {
+    return (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1014) || (code >= 3000 && code <= 4999);
+}
+
+static bool isValidUtf8(std::string_view text) {
+    const auto* data = reinterpret_cast<const unsigned char*>(text.data());
+    for (size_t i = 0; i < text.size();) {
+        if (data[i] < 0x80) {
+            ++i;
+            continue;
+        }
+        size_t sequence = utf8SequenceLength(data, text.size(), i);
+        if (sequence == 0) {
+            return false;
+        }
+        i += sequence;
+    }
+    return true;
+}
+
+// 解析由服务器自己处理的控制消息:
+//   {"type": "resume", "last_seq": N}
+//   {"type": "subscribe", "events": ["player_msg", ...], "players": ["Steve", ...]}
+//   {"type": "hello", "features": ["player_ids"]}
+// 其他消息 (群消息等) 返回 discarded，交给消息回调
+static bool isControlType(std::string_view type) {
+    return type == "resume" || type == "subscribe" || type == "hello";
+}
+
+static nlohmann::json parseControlMessage(const std::string& message, MessageEncoding encoding) {
+    nlohmann::json discarded(nlohmann::json::value_t::discarded);
+
+    // 绝大多数入站消息是群消息: JSON 先单遍扫描出顶层 type，只有控制消息才构造 DOM，
+    // 消息内容中出现 "resume" 等字样的群消息不会被额外完整解析一次
+    if (encoding == MessageEncoding::Json) {
+        thread_local InboundScanner scanner;
+        GroupMessageFields fields{};
+        if (scanner.scan(message, fields) && !isControlType(fields.type)) {
+            return discarded;
+        }
+    }
+    // 扫描器不处理的输入和 MessagePack 先做廉价的子串检查
+    if (message.find("resume") == std::string::npos && message.find("subscribe") == std::string::npos
+        && message.find("hello") == std::string::npos) {
+        return discarded;
+    }
+    nlohmann::json json = encoding == MessageEncoding::MsgPack ? nlohmann::json::from_msgpack(message, true, false)
+                                                               : nlohmann::json::parse(message, nullptr, false);
+    if (!json.is_object()) {
+        return discarded;
+    }
+    auto type = json.find("type");
+    if (type == json.end() || !type->is_string()) {
+        return discarded;
+    }
+    if (!isControlType(type->get_ref<const std::string&>())) {
+        return discarded;
+    }
+    return json;
+}
+
+// 由 subscribe 消息生成订阅，省略 events 表示所有类型，省略 players 或为空表示所有玩家
+// 返回 nullptr 表示接收所有事件
+static std::shared_ptr<const Subscription> parseSubscription(const nlohmann::json& json,
+                                                             std::vector<std::string>& unknownEvents) {
+    auto subscription = std::make_shared<Subscription>();
+
+    auto events = json.find("events");
+    if (events != json.end() && events->is_array()) {
+        subscription->topics = 0;
+        for (const auto& item : *events) {
+            EventType type;
+            if (item.is_string() && parseEventType(item.get_ref<const std::string&>(), type)) {
+                subscription->topics |= topicBit(type);
+            } else {
+                unknownEvents.push_back(item.dump());
+            }
+        }
+    }
+
+    auto players = json.find("players");
+    if (players != json.end() && players->is_array()) {
+        for (const auto& item : *players) {
+            if (item.is_string()) {
+                subscription->players.push_back(item.get<std::string>());
+            }
+        }
+        std::sort(subscription->players.begin(), subscription->players.end());
+        subscription->players.erase(std::unique(subscription->players.begin(), subscription->players.end()),
+                                    subscription->players.end());
+    }
+
+    if (subscription->topics == DefaultTopics && subscription->players.empty()) {
+        return nullptr;
+    }
+    return subscription;
+}
+
+// 拼接选中元素的 JSON 编码 (元素已是合法 JSON)，compact 为 true 时优先使用元素的紧凑编码
+static std::string joinJson(const std::vector<EncodedMessage>& messages, const std::string& include, bool compact) {
+    size_t total = 2;
+    for (size_t i = 0; i < messages.size(); ++i) {
+        if (include.empty() || include[i] == '1') {
+            const auto& item = messages[i];
+            total += (compact && !item.compactJson.empty() ? item.compactJson : item.json).size() + 1;
+        }
+    }
+    std::string array;
+    array.reserve(total);
+    array.push_back('[');
+    for (size_t i = 0; i < messages.size(); ++i) {
+        if (!include.empty() && include[i] != '1') {
+            continue;
+        }
+        if (array.size() > 1) {
+            array.push_back(',');
+        }
+        const auto& item = messages[i];
+        array.append(compact && !item.compactJson.empty() ? item.compactJson : item.json);
+    }
+    array.push_back(']');
+    return array;
+}
+
+// MessagePack 数组同样由数组头加上已编码的元素拼接而成
+static std::string joinMsgPack(const std::vector<EncodedMessage>& messages, const std::string& include, size_t count,
+                               bool compact) {
+    std::string array;
+    if (count < 16) {
+        array.push_back(static_cast<char>(0x90 | count));
+    } else if (count <= 0xFFFF) {
+        array.push_back(static_cast<char>(0xDC));
+        array.push_back(static_cast<char>((count >> 8) & 0xFF));
+        array.push_back(static_cast<char>(count & 0xFF));
+    } else {
+        array.push_back(static_cast<char>(0xDD));
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            array.push_back(static_cast<char>((count >> shift) & 0xFF));
+        }
+    }
+    for (size_t i = 0; i < messages.size(); ++i) {
+        if (include.empty() || include[i] == '1') {
+            const auto& item = messages[i];
+            array.append(compact && !item.compactMsgpack.empty() ? item.compactMsgpack : item.msgpack);
+        }
+    }
+    return array;
+}
+
+// 把选中的消息合并为一个数组消息: JSON 数组，所有元素都有 MessagePack 编码时同时生成 MessagePack 数组；
+// 有元素带紧凑编码时同时生成紧凑数组
+// include 为空表示全部选中，否则 include[i] 为 '1' 表示选中第 i 条
+static EncodedMessage joinMessages(const std::vector<EncodedMessage>& messages, const std::string& include) {
+    EncodedMessage array;
+    size_t count = 0;
+    bool withMsgPack = true;
+    bool withCompact = false;
+    for (size_t i = 0; i < messages.size(); ++i) {
+        if (!include.empty() && include[i] != '1') {
+            continue;
+        }
+        const auto& item = messages[i];
+        ++count;
+        withMsgPack = withMsgPack && !item.msgpack.empty();
+        withCompact = withCompact || !item.compactJson.empty();
+        array.seq = std::max(array.seq, item.seq);
+        array.topic |= item.topic;
+    }
+
+    array.json = joinJson(messages, include, false);
+    if (withCompact) {
+        array.compactJson = joinJson(messages, include, true);
+    }
+    if (withMsgPack && count > 0) {
+        array.msgpack = joinMsgPack(messages, include, count, false);
+        if (withCompact) {
+            array.compactMsgpack = joinMsgPack(messages, include, count, true);
+        }
+    }
+    return array;
+}
+
+WebSocketServer::WebSocketServer(const std::string& host, int port, const Config& config, Logger& logger)
+    : mHost(host), mPort(port), mConfig(config), mLogger(logger),
+      mInboundRateLimit(RateLimit::perMinute(config.clientMessageRateLimit, config.clientMessageBurst)),
+      mTimers(TIMER_RESOLUTION, TIMER_SLOTS) {
 }
 
 WebSocketServer::~WebSocketServer() {
@@ -19,493 +245,1438 @@ WebSocketServer::~WebSocketServer() {
 }
 
 bool WebSocketServer::start() {
-    mMod->getSelf().getLogger().debug("Initializing Winsock...");
+    mLogger.debug("Initializing socket library...");
     
-    // 初始化 Winsock
-    WSADATA wsaData;
-    int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
-    if (result != 0) {
-        mMod->getSelf().getLogger().error("WSAStartup failed: {}", result);
+    // 初始化 socket 库 (Windows 下为 Winsock)
+    int result = 0;
+    if (!socketStartup(result)) {
+        mLogger.error("WSAStartup failed: {}", result);
         return false;
     }
-    mMod->getSelf().getLogger().trace("Winsock initialized successfully");
+    mLogger.trace("Socket library initialized successfully");
 
     // 创建服务器 socket
-    mMod->getSelf().getLogger().debug("Creating server socket...");
+    mLogger.debug("Creating server socket...");
     mServerSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (mServerSocket == INVALID_SOCKET) {
-        mMod->getSelf().getLogger().error("Failed to create socket: {}", WSAGetLastError());
-        WSACleanup();
+    if (mServerSocket == InvalidSocket) {
+        mLogger.error("Failed to create socket: {}", lastSocketError());
+        socketCleanup();
         return false;
     }
-    mMod->getSelf().getLogger().trace("Server socket created: {}", static_cast<int>(mServerSocket));
+    mLogger.trace("Server socket created: {}", static_cast<int>(mServerSocket));
 
     // 设置 socket 选项
     int opt = 1;
     setsockopt(mServerSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
-    mMod->getSelf().getLogger().trace("Socket options set (SO_REUSEADDR)");
+    mLogger.trace("Socket options set (SO_REUSEADDR)");
 
     // 绑定地址
     sockaddr_in serverAddr{};
     serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(static_cast<u_short>(mPort));
+    serverAddr.sin_port = htons(static_cast<uint16_t>(mPort));
     
     if (mHost == "0.0.0.0") {
         serverAddr.sin_addr.s_addr = INADDR_ANY;
-        mMod->getSelf().getLogger().debug("Binding to all interfaces (0.0.0.0)");
+        mLogger.debug("Binding to all interfaces (0.0.0.0)");
     } else {
         inet_pton(AF_INET, mHost.c_str(), &serverAddr.sin_addr);
-        mMod->getSelf().getLogger().debug("Binding to specific host: {}", mHost);
+        mLogger.debug("Binding to specific host: {}", mHost);
     }
 
-    if (bind(mServerSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
-        mMod->getSelf().getLogger().error("Bind failed on port {}: {}", mPort, WSAGetLastError());
-        closesocket(mServerSocket);
-        WSACleanup();
+    if (bind(mServerSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) != 0) {
+        mLogger.error("Bind failed on port {}: {}", mPort, lastSocketError());
+        closeSocket(mServerSocket);
+        mServerSocket = InvalidSocket;
+        socketCleanup();
         return false;
     }
-    mMod->getSelf().getLogger().debug("Successfully bound to port {}", mPort);
+    mLogger.debug("Successfully bound to port {}", mPort);
 
     // 开始监听
-    if (listen(mServerSocket, SOMAXCONN) == SOCKET_ERROR) {
-        mMod->getSelf().getLogger().error("Listen failed: {}", WSAGetLastError());
-        closesocket(mServerSocket);
-        WSACleanup();
+    if (listen(mServerSocket, SOMAXCONN) != 0) {
+        mLogger.error("Listen failed: {}", lastSocketError());
+        closeSocket(mServerSocket);
+        mServerSocket = InvalidSocket;
+        socketCleanup();
         return false;
     }
-    mMod->getSelf().getLogger().debug("Socket is now listening (backlog: SOMAXCONN)");
+    mLogger.debug("Socket is now listening (backlog: SOMAXCONN)");
+
+    // 发送队列配置
+    const auto& config = mConfig;
+    mQueueCapacity = static_cast<size_t>(std::max(config.sendQueueCapacity, 1));
+    mOverflowPolicy = parseOverflowPolicy(config.sendQueueOverflowPolicy);
+    mLogger.debug("Send queue capacity: {}, overflow policy: {}", 
+                  mQueueCapacity, config.sendQueueOverflowPolicy);
+
+    // permessage-deflate 配置
+    mDeflateEnabled = config.enablePerMessageDeflate;
+    mDeflateClientNoContextTakeover = config.deflateClientNoContextTakeover;
+    mDeflateMinPayloadSize = static_cast<size_t>(std::max(config.deflateMinPayloadSize, 0));
+    if (mDeflateEnabled) {
+        mLogger.debug("permessage-deflate enabled (min payload size: {})", mDeflateMinPayloadSize);
+    }
+
+    mMsgPackEnabled = config.enableMsgPackProtocol;
+    mMetricsEnabled = config.enableMetricsEndpoint;
+    mMetricsAllowRemote = config.metricsAllowRemote;
+
+    // 心跳和超时配置
+    auto toDuration = [](int ms) { return std::chrono::milliseconds(std::max(ms, 0)); };
+    mHandshakeTimeout = toDuration(config.handshakeTimeoutMs);
+    mIdleTimeout = toDuration(config.idleTimeoutMs);
+    mPingInterval = toDuration(config.pingIntervalMs);
+    mPongTimeout = toDuration(config.pongTimeoutMs);
+    mSlowConsumerTimeout = toDuration(config.slowConsumerTimeoutMs);
+    mSlowConsumerQueueThreshold = static_cast<size_t>(std::max(config.slowConsumerQueueThreshold, 0));
+    mSlowConsumerMaxBytes = static_cast<size_t>(std::max(config.slowConsumerMaxBytes, 0));
+    mLogger.debug("Ping interval: {} ms, pong timeout: {} ms, idle timeout: {} ms, handshake timeout: {} ms",
+                  mPingInterval.count(), mPongTimeout.count(), mIdleTimeout.count(), mHandshakeTimeout.count());
+
+    // 创建事件循环
+    if (!setNonBlocking(mServerSocket) || !mPoller.open()
+        || !mPoller.add(mServerSocket, LISTENER_TOKEN, Poller::Readable)) {
+        mLogger.error("Failed to initialize event loop: {}", lastSocketError());
+        mPoller.close();
+        closeSocket(mServerSocket);
+        mServerSocket = InvalidSocket;
+        socketCleanup();
+        return false;
+    }
+
+    // 本机传输是可选的，监听失败时只影响本机连接
+    if (!mLocalSocketPath.empty()) {
+        int error = 0;
+        mLocalSocket = listenLocal(mLocalSocketPath, error);
+        if (mLocalSocket == InvalidSocket) {
+            mLogger.error("Failed to listen on local socket {}: {}", mLocalSocketPath, error);
+        } else if (!mPoller.add(mLocalSocket, LOCAL_LISTENER_TOKEN, Poller::Readable)) {
+            mLogger.error("Failed to register local socket: {}", lastSocketError());
+            closeSocket(mLocalSocket);
+            mLocalSocket = InvalidSocket;
+            removeLocalSocketFile(mLocalSocketPath);
+        } else {
+            mLogger.info("Local transport listening on {}", mLocalSocketPath);
+        }
+    }
 
     mRunning = true;
-    mAcceptThread = std::thread(&WebSocketServer::acceptLoop, this);
-    mMod->getSelf().getLogger().debug("Accept thread started");
+    mLoopThread = std::thread(&WebSocketServer::runLoop, this);
+    mLogger.debug("Event loop thread started");
 
-    mMod->getSelf().getLogger().info("WebSocket server started on ws://{}:{}", mHost, mPort);
+    mLogger.info("WebSocket server started on ws://{}:{}", mHost, mPort);
     return true;
 }
 
 void WebSocketServer::stop() {
     if (!mRunning) {
-        mMod->getSelf().getLogger().debug("WebSocket server already stopped");
+        mLogger.debug("WebSocket server already stopped");
         return;
     }
     
-    mMod->getSelf().getLogger().debug("Stopping WebSocket server...");
+    mLogger.debug("Stopping WebSocket server...");
     mRunning = false;
+    mPoller.wakeup();
 
-    // 关闭服务器 socket，这会让 accept() 返回
-    if (mServerSocket != INVALID_SOCKET) {
-        mMod->getSelf().getLogger().trace("Closing server socket...");
-        closesocket(mServerSocket);
-        mServerSocket = INVALID_SOCKET;
+    // 等待事件循环线程结束，连接和监听 socket 由事件循环线程在退出前关闭
+    if (mLoopThread.joinable()) {
+        mLogger.trace("Waiting for event loop thread to finish...");
+        mLoopThread.join();
     }
 
-    // 关闭所有客户端连接
-    {
-        std::lock_guard<std::mutex> lock(mClientsMutex);
-        mMod->getSelf().getLogger().debug("Closing {} client connections...", mClients.size());
-        for (SOCKET client : mClients) {
-            closesocket(client);
-        }
-        mClients.clear();
+    mPoller.close();
+    socketCleanup();
+    mLogger.info("WebSocket server stopped");
+}
+
+WebSocketServer::FrameSet WebSocketServer::makeFrameSet(EncodedMessage&& message) {
+    FrameSet frames;
+    frames.seq = message.seq;
+    frames.topic = message.topic;
+    frames.player = std::move(message.player);
+    frames.json.plain = OutboundFrame::text(std::move(message.json));
+    if (!message.msgpack.empty()) {
+        frames.msgpack.plain = OutboundFrame::binary(std::move(message.msgpack));
+    }
+    if (!message.compactJson.empty()) {
+        frames.compactJson.plain = OutboundFrame::text(std::move(message.compactJson));
+    }
+    if (!message.compactMsgpack.empty()) {
+        frames.compactMsgpack.plain = OutboundFrame::binary(std::move(message.compactMsgpack));
     }
+    return frames;
+}
 
-    // 等待接受线程结束
-    if (mAcceptThread.joinable()) {
-        mMod->getSelf().getLogger().trace("Waiting for accept thread to finish...");
-        mAcceptThread.join();
+void WebSocketServer::finishEnqueueLocked(size_t overflowed) {
+    if (overflowed > 0) {
+        MCWS_DEBUG(mLogger, "{} clients overflowed their send queue, marking for removal", overflowed);
     }
 
-    WSACleanup();
-    mMod->getSelf().getLogger().info("WebSocket server stopped");
+    if (!mQueues.empty()) {
+        requestWakeup();
+    }
 }
 
-void WebSocketServer::broadcast(const std::string& message) {
-    std::lock_guard<std::mutex> lock(mClientsMutex);
+void WebSocketServer::broadcast(EncodedMessage message) {
+    // 每条消息只编码一次，所有客户端队列共享同一帧
+    FrameSet frames = makeFrameSet(std::move(message));
     
-    mMod->getSelf().getLogger().trace("Broadcasting to {} clients: {}", mClients.size(), message);
+    std::lock_guard<std::mutex> lock(mQueuesMutex);
     
-    std::vector<SOCKET> disconnected;
+    MCWS_TRACE(mLogger, "Broadcasting to {} clients: {}", mQueues.size(), frames.json.plain->payload());
     
-    for (SOCKET client : mClients) {
-        if (!sendFrame(client, message)) {
-            mMod->getSelf().getLogger().debug("Failed to send to client, marking for removal");
-            disconnected.push_back(client);
+    size_t overflowed = 0;
+    enqueueLocked(frames, overflowed);
+    finishEnqueueLocked(overflowed);
+}
+
+void WebSocketServer::broadcastBatch(std::vector<EncodedMessage>& messages) {
+    std::vector<FrameSet> frames;
+    frames.reserve(messages.size());
+    for (auto& message : messages) {
+        frames.push_back(makeFrameSet(std::move(message)));
+    }
+
+    std::lock_guard<std::mutex> lock(mQueuesMutex);
+
+    MCWS_TRACE(mLogger, "Broadcasting batch of {} messages to {} clients", frames.size(), mQueues.size());
+
+    size_t overflowed = 0;
+    for (auto& frame : frames) {
+        enqueueLocked(frame, overflowed);
+    }
+
+    finishEnqueueLocked(overflowed);
+}
+
+void WebSocketServer::broadcastArray(const std::vector<EncodedMessage>& messages) {
+    FrameSet all = makeFrameSet(joinMessages(messages, std::string()));
+
+    std::lock_guard<std::mutex> lock(mQueuesMutex);
+
+    MCWS_TRACE(mLogger, "Broadcasting array of {} messages to {} clients", messages.size(), mQueues.size());
+
+    // 设置了订阅的客户端按匹配结果分组，每种结果只合并和编码一次
+    std::unordered_map<std::string, FrameSet> filtered;
+    std::optional<FrameSet> mapping;
+    std::string include;
+    size_t overflowed = 0;
+    for (auto& [id, client] : mQueues) {
+        if (client.replaying || (all.seq != 0 && all.seq <= client.replayedThrough)) {
+            continue;
+        }
+
+        FrameSet* frames = &all;
+        if (client.subscription) {
+            include.assign(messages.size(), '0');
+            size_t matched = 0;
+            for (size_t i = 0; i < messages.size(); ++i) {
+                const auto& message = messages[i];
+                if (message.topic == 0 || client.subscription->matches(message.topic, message.player)) {
+                    include[i] = '1';
+                    ++matched;
+                }
+            }
+            if (matched == 0) {
+                continue;
+            }
+            if (matched < messages.size()) {
+                auto it = filtered.find(include);
+                if (it == filtered.end()) {
+                    it = filtered.emplace(include, makeFrameSet(joinMessages(messages, include))).first;
+                }
+                frames = &it->second;
+            }
+        }
+
+        if (usesCompact(*frames, client)) {
+            syncPlayerIdsLocked(client, mapping);
+        }
+        const FrameRef* frame = selectFrameLocked(*frames, client);
+        if (frame && !client.queue->push(*frame)) {
+            ++overflowed;
         }
     }
-    
-    // 移除断开的连接
-    for (SOCKET client : disconnected) {
-        mClients.erase(client);
-        closesocket(client);
-        mMod->getSelf().getLogger().debug("Removed disconnected client");
+
+    finishEnqueueLocked(overflowed);
+}
+
+void WebSocketServer::broadcastTelemetry(EncodedMessage delta,
+                                         const std::function<EncodedMessage()>& makeKeyframe) {
+    FrameSet deltaFrames = makeFrameSet(std::move(delta));
+    std::optional<FrameSet> keyframeFrames;
+
+    std::lock_guard<std::mutex> lock(mQueuesMutex);
+
+    size_t overflowed = 0;
+    for (auto& [id, client] : mQueues) {
+        if (!client.subscription || !(client.subscription->topics & topicBit(EventType::Telemetry))) {
+            continue;
+        }
+        // 重放期间不发送，之后从关键帧重新开始
+        if (client.replaying) {
+            client.telemetrySynced = false;
+            continue;
+        }
+
+        // 丢过帧的客户端可能缺少上一次的增量
+        uint64_t drops = client.queue->droppedCount();
+        FrameSet* frames = &deltaFrames;
+        if (makeKeyframe && (!client.telemetrySynced || drops != client.telemetryDrops)) {
+            if (!keyframeFrames) {
+                keyframeFrames = makeFrameSet(makeKeyframe());
+            }
+            frames = &*keyframeFrames;
+        }
+
+        const FrameRef* frame = selectFrameLocked(*frames, client);
+        if (!frame) {
+            client.telemetrySynced = false;
+            continue;
+        }
+        client.telemetrySynced = true;
+        client.telemetryDrops = drops;
+        if (!client.queue->push(*frame)) {
+            ++overflowed;
+        }
     }
-    
-    if (!disconnected.empty()) {
-        mMod->getSelf().getLogger().debug("Removed {} disconnected clients, {} remaining", 
-                                          disconnected.size(), mClients.size());
+
+    finishEnqueueLocked(overflowed);
+}
+
+void WebSocketServer::enqueueLocked(FrameSet& frames, size_t& overflowed) {
+    std::optional<FrameSet> mapping;
+    for (auto& [id, client] : mQueues) {
+        if (client.replaying || (frames.seq != 0 && frames.seq <= client.replayedThrough)) {
+            continue;
+        }
+        if (client.subscription && frames.topic != 0 && !client.subscription->matches(frames.topic, frames.player)) {
+            continue;
+        }
+        if (usesCompact(frames, client)) {
+            syncPlayerIdsLocked(client, mapping);
+        }
+        const FrameRef* frame = selectFrameLocked(frames, client);
+        if (frame && !client.queue->push(*frame)) {
+            ++overflowed;
+        }
+    }
+}
+
+bool WebSocketServer::usesCompact(const FrameSet& frameSet, const ClientEntry& client) {
+    if (!client.playerIds) {
+        return false;
+    }
+    // 未订阅 player_join 的客户端收不到 ID 首次出现时附带的名称，仍使用完整编码
+    if (client.subscription && !(client.subscription->topics & topicBit(EventType::PlayerJoin))) {
+        return false;
+    }
+    return client.encoding == MessageEncoding::MsgPack ? frameSet.compactMsgpack.plain != nullptr
+                                                       : frameSet.compactJson.plain != nullptr;
+}
+
+void WebSocketServer::syncPlayerIdsLocked(ClientEntry& client, std::optional<FrameSet>& mapping) {
+    // 丢过帧的客户端可能错过了某个 ID 首次出现时附带的名称
+    if (client.playerIdsSynced && client.queue->droppedCount() == client.playerIdsDrops) {
+        return;
+    }
+    if (!mapping) {
+        nlohmann::json players = nlohmann::json::array();
+        for (auto& [id, name] : mPlayerIds.snapshot()) {
+            players.push_back({{"player_id", id}, {"player_name", std::move(name)}});
+        }
+        nlohmann::json msg = {{"type", "player_ids"}, {"players", std::move(players)}};
+        EncodedMessage message;
+        message.json = msg.dump();
+        std::vector<std::uint8_t> packed = nlohmann::json::to_msgpack(msg);
+        message.msgpack.assign(packed.begin(), packed.end());
+        mapping = makeFrameSet(std::move(message));
+    }
+    if (const FrameRef* frame = selectFrameLocked(*mapping, client)) {
+        client.queue->push(*frame);
+    }
+    client.playerIdsSynced = true;
+    client.playerIdsDrops = client.queue->droppedCount();
+}
+
+const FrameRef* WebSocketServer::selectFrameLocked(FrameSet& frameSet, const ClientEntry& client) {
+    bool binary = client.encoding == MessageEncoding::MsgPack;
+    EncodedFrames& frames = usesCompact(frameSet, client) ? (binary ? frameSet.compactMsgpack : frameSet.compactJson)
+                                                          : (binary ? frameSet.msgpack : frameSet.json);
+    int deflateWindowBits = client.deflateWindowBits;
+
+    // 客户端在广播方编码之后才完成握手时可能缺少对应编码，跳过这条消息
+    if (!frames.plain) {
+        return nullptr;
+    }
+
+    // 本机连接不压缩，长度前缀帧每条消息只构造一次
+    if (client.local) {
+        if (!frames.local) {
+            frames.local = OutboundFrame::lengthPrefixed(frames.plain->opcode(), frames.plain->payload());
+        }
+        return &frames.local;
+    }
+
+    // 未协商压缩或消息太短时直接使用未压缩的帧
+    if (deflateWindowBits <= 0 || frames.plain->payload().size() < mDeflateMinPayloadSize) {
+        return &frames.plain;
+    }
+
+    if (!frames.deflateTried[deflateWindowBits]) {
+        frames.deflateTried[deflateWindowBits] = true;
+
+        auto& compressor = mCompressors[deflateWindowBits];
+        if (!compressor) {
+            compressor = std::make_unique<DeflateCompressor>(deflateWindowBits);
+        }
+
+        std::string compressed;
+        if (compressor->compress(frames.plain->payload(), compressed)
+            && compressed.size() < frames.plain->payload().size()) {
+            frames.deflated[deflateWindowBits] = binary ? OutboundFrame::binary(std::move(compressed), true)
+                                                        : OutboundFrame::text(std::move(compressed), true);
+        }
+    }
+
+    // 压缩失败或没有变小时退回未压缩的帧
+    return frames.deflated[deflateWindowBits] ? &frames.deflated[deflateWindowBits] : &frames.plain;
+}
+
+void WebSocketServer::processTimers() {
+    auto now = TimerWheel::Clock::now();
+    std::vector<uint64_t> expired;
+    mTimers.advance(now, expired);
+
+    for (uint64_t id : expired) {
+        auto it = mSessions.find(id);
+        if (it == mSessions.end()) {
+            continue; // 连接已关闭
+        }
+        Session& session = *it->second;
+        session.timerScheduled = false;
+        if (!session.closing) {
+            checkSession(session, now);
+        }
+        if (session.closing) {
+            closeSession(id);
+        }
+    }
+}
+
+void WebSocketServer::checkSession(Session& session, TimerWheel::Clock::time_point now) {
+    // 已发出关闭帧，只等待写完或超时
+    if (session.closeAfterWrite) {
+        if (now - session.closeSentAt >= CLOSE_TIMEOUT) {
+            mLogger.debug("Close frame to {} not flushed in time, disconnecting", session.peer);
+            session.closing = true;
+        }
+        return;
+    }
+
+    auto nextCheck = TimerWheel::Clock::time_point::max();
+    auto consider = [&nextCheck](TimerWheel::Clock::time_point when) {
+        nextCheck = std::min(nextCheck, when);
+    };
+
+    if (session.state == Session::State::Handshake) {
+        if (mHandshakeTimeout.count() > 0) {
+            if (now - session.connectedAt >= mHandshakeTimeout) {
+                mLogger.warn("WebSocket handshake timed out for {}", session.peer);
+                mMetrics.disconnects[static_cast<size_t>(DisconnectReason::HandshakeTimeout)].add();
+                session.closing = true;
+                return;
+            }
+            consider(session.connectedAt + mHandshakeTimeout);
+        }
+    } else {
+        // 长时间没有收到任何数据 (包括 pong)，视为半开连接
+        // 本机连接的对端退出时内核会直接关闭连接，不需要空闲超时和心跳
+        if (mIdleTimeout.count() > 0 && !session.local) {
+            if (now - session.lastReceive >= mIdleTimeout) {
+                mLogger.warn("Client {} idle for {} ms, disconnecting", session.peer, mIdleTimeout.count());
+                mMetrics.disconnects[static_cast<size_t>(DisconnectReason::IdleTimeout)].add();
+                session.closing = true;
+                return;
+            }
+            consider(session.lastReceive + mIdleTimeout);
+        }
+
+        if (mPingInterval.count() > 0 && !session.local) {
+            if (session.awaitingPong) {
+                if (now - session.lastPingSent >= mPongTimeout) {
+                    mLogger.warn("Client {} did not answer ping within {} ms, disconnecting",
+                                 session.peer, mPongTimeout.count());
+                    mMetrics.disconnects[static_cast<size_t>(DisconnectReason::PongTimeout)].add();
+                    session.closing = true;
+                    return;
+                }
+                consider(session.lastPingSent + mPongTimeout);
+            } else {
+                if (now - session.lastPingSent >= mPingInterval) {
+                    session.lastPingSent = now;
+                    session.awaitingPong = mPongTimeout.count() > 0;
+                    queueSend(session, makeControlFrame(session.local, 0x9, {}));
+                    if (session.closing) {
+                        return;
+                    }
+                    if (session.awaitingPong) {
+                        consider(now + mPongTimeout);
+                    }
+                }
+                consider(session.lastPingSent + mPingInterval);
+            }
+        }
+
+        // 发送积压持续超过阈值的客户端拖慢所有广播，超时后断开
+        if (mSlowConsumerTimeout.count() > 0 && (mSlowConsumerQueueThreshold > 0 || mSlowConsumerMaxBytes > 0)) {
+            bool slow = (mSlowConsumerQueueThreshold > 0 && session.queue->size() >= mSlowConsumerQueueThreshold)
+                     || (mSlowConsumerMaxBytes > 0 && pendingBytes(session) >= mSlowConsumerMaxBytes);
+            if (!slow) {
+                session.slow = false;
+            } else if (!session.slow) {
+                session.slow = true;
+                session.slowSince = now;
+            } else if (now - session.slowSince >= mSlowConsumerTimeout) {
+                mLogger.warn("Client {} has been a slow consumer for {} ms ({} bytes pending), disconnecting",
+                             session.peer, mSlowConsumerTimeout.count(), pendingBytes(session));
+                mMetrics.disconnects[static_cast<size_t>(DisconnectReason::SlowConsumer)].add();
+                session.closing = true;
+                return;
+            }
+            consider(now + SLOW_CONSUMER_SAMPLE_INTERVAL);
+            if (session.slow) {
+                consider(session.slowSince + mSlowConsumerTimeout);
+            }
+        }
+    }
+
+    if (nextCheck != TimerWheel::Clock::time_point::max()) {
+        mTimers.schedule(session.id, nextCheck);
+        session.timerScheduled = true;
+    }
+}
+
+size_t WebSocketServer::pendingBytes(const Session& session) const {
+    size_t bytes = session.queue ? session.queue->bytes() : 0;
+    for (size_t i = session.writeIndex; i < session.writeFrames.size(); ++i) {
+        bytes += session.writeFrames[i]->size();
+    }
+    if (session.writeIndex < session.writeFrames.size()) {
+        bytes -= session.writeOffset;
+    }
+    return bytes;
+}
+
+void WebSocketServer::requestWakeup() {
+    // 事件循环处理队列前会清除该标志，期间的多次入队只需唤醒一次
+    if (!mWakeupPending.exchange(true)) {
+        mPoller.wakeup();
     }
 }
 
 void WebSocketServer::setMessageCallback(MessageCallback callback) {
     mMessageCallback = std::move(callback);
-    mMod->getSelf().getLogger().debug("Message callback set");
+    mLogger.debug("Message callback set");
 }
 
-void WebSocketServer::acceptLoop() {
-    mMod->getSelf().getLogger().debug("Accept loop started");
+void WebSocketServer::runLoop() {
+    mLogger.debug("Event loop started");
+
+    std::vector<Poller::Event> events;
     while (mRunning) {
-        sockaddr_in clientAddr{};
-        int clientAddrLen = sizeof(clientAddr);
+        // 等待到下一个时间片，没有定时器时最多等待 1 秒以便及时响应停止
+        int timeoutMs = mTimers.nextTimeoutMs(TimerWheel::Clock::now());
+        if (timeoutMs < 0 || timeoutMs > MAX_POLL_TIMEOUT_MS) {
+            timeoutMs = MAX_POLL_TIMEOUT_MS;
+        }
+        if (mPoller.wait(events, timeoutMs) < 0) {
+            mLogger.warn("Poll failed with error: {}", lastSocketError());
+            continue;
+        }
+
+        // 先清除唤醒标志，再处理队列，避免遗漏之后入队的帧
+        mWakeupPending = false;
+
+        for (const auto& event : events) {
+            if (event.token == Poller::WakeupToken) {
+                continue;
+            }
+            if (event.token == LISTENER_TOKEN) {
+                acceptPending(mServerSocket, false);
+                continue;
+            }
+            if (event.token == LOCAL_LISTENER_TOKEN) {
+                acceptPending(mLocalSocket, true);
+                continue;
+            }
+
+            auto it = mSessions.find(event.token);
+            if (it == mSessions.end()) {
+                continue;
+            }
+            Session& session = *it->second;
+            if (event.events & Poller::Writable) {
+                onWritable(session);
+            }
+            if ((event.events & Poller::Readable) && !session.closing) {
+                onReadable(session);
+            }
+            if (session.closing) {
+                closeSession(session.id);
+            }
+        }
+
+        flushQueues();
+        processTimers();
+    }
+
+    // 关闭所有客户端连接
+    mLogger.debug("Closing {} client connections...", mSessions.size());
+    while (!mSessions.empty()) {
+        closeSession(mSessions.begin()->first);
+    }
+
+    // 关闭服务器 socket
+    if (mServerSocket != InvalidSocket) {
+        mLogger.trace("Closing server socket...");
+        mPoller.remove(mServerSocket);
+        closeSocket(mServerSocket);
+        mServerSocket = InvalidSocket;
+    }
+    if (mLocalSocket != InvalidSocket) {
+        mPoller.remove(mLocalSocket);
+        closeSocket(mLocalSocket);
+        mLocalSocket = InvalidSocket;
+        removeLocalSocketFile(mLocalSocketPath);
+    }
+
+    mLogger.debug("Event loop ended");
+}
+
+void WebSocketServer::acceptPending(SocketHandle listener, bool local) {
+    while (mRunning) {
+        sockaddr_storage clientAddr{};
+        socklen_t clientAddrLen = sizeof(clientAddr);
         
-        SOCKET clientSocket = accept(mServerSocket, (sockaddr*)&clientAddr, &clientAddrLen);
+        SocketHandle clientSocket = accept(listener, (sockaddr*)&clientAddr, &clientAddrLen);
         
-        if (clientSocket == INVALID_SOCKET) {
-            if (mRunning) {
-                // 真正的错误
-                int error = WSAGetLastError();
-                if (error != WSAEINTR && error != WSAENOTSOCK) {
-                    mMod->getSelf().getLogger().warn("Accept failed with error: {}", error);
-                }
+        if (clientSocket == InvalidSocket) {
+            int error = lastSocketError();
+            if (!isWouldBlock(error)) {
+                mLogger.warn("Accept failed with error: {}", error);
             }
+            return;
+        }
+
+        auto session = std::make_unique<Session>();
+        session->id = mNextSessionId++;
+        session->socket = clientSocket;
+        session->local = local;
+        // 本机连接的对端地址没有意义，用连接 id 区分
+        session->peer = local ? "local#" + std::to_string(session->id)
+                              : formatPeerAddress(reinterpret_cast<const sockaddr_in&>(clientAddr));
+        session->loopback = local || isLoopbackAddress(reinterpret_cast<const sockaddr_in&>(clientAddr));
+        session->connectedAt = TimerWheel::Clock::now();
+        session->lastReceive = session->connectedAt;
+        mMetrics.connectionsAccepted.add();
+
+        // 可能只是 /metrics 抓取，等握手成功后再按 info 输出
+        mLogger.debug("New connection from {}", session->peer);
+        mLogger.debug("Client socket: {}", static_cast<int>(clientSocket));
+
+        // 出站数据已在应用层合并 (批量模式或一次分散写多个帧)，关闭 Nagle 避免额外的发送延迟
+        if (!local) {
+            setNoDelay(clientSocket, true);
+        }
+
+        if (!setNonBlocking(clientSocket) || !mPoller.add(clientSocket, session->id, Poller::Readable)) {
+            mLogger.warn("Failed to register client socket: {}", lastSocketError());
+            closeSocket(clientSocket);
             continue;
         }
 
-        // 获取客户端 IP
-        char clientIP[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &clientAddr.sin_addr, clientIP, INET_ADDRSTRLEN);
-        mMod->getSelf().getLogger().info("New WebSocket connection from {}:{}", clientIP, ntohs(clientAddr.sin_port));
-        mMod->getSelf().getLogger().debug("Client socket: {}", static_cast<int>(clientSocket));
+        MCWS_DEBUG(mLogger, "Waiting for {} handshake...", local ? "local protocol" : "WebSocket");
+        if (mHandshakeTimeout.count() > 0) {
+            mTimers.schedule(session->id, session->connectedAt + mHandshakeTimeout);
+            session->timerScheduled = true;
+        }
+        mSessions.emplace(session->id, std::move(session));
+    }
+}
+
+void WebSocketServer::onReadable(Session& session) {
+    char chunk[READ_CHUNK_SIZE];
+
+    // 读取直到暂无数据；已发出关闭帧的连接继续读取并丢弃数据，等待对方关闭
+    size_t readThisEvent = 0;
+    while (readThisEvent < MAX_READ_PER_EVENT && !session.closing) {
+        int64_t received = recvSome(session.socket, chunk, sizeof(chunk));
+        if (received == 0) {
+            mLogger.debug("Connection closed by peer");
+            session.closing = true;
+            return;
+        }
+        if (received < 0) {
+            if (!isWouldBlock(lastSocketError())) {
+                mLogger.debug("Receive failed with error: {}", lastSocketError());
+                session.closing = true;
+                return;
+            }
+            break;
+        }
+        readThisEvent += static_cast<size_t>(received);
+        session.lastReceive = TimerWheel::Clock::now();
+
+        if (session.state == Session::State::Open) {
+            // 握手之后的数据直接交给帧解析器，一次读取可能包含多个帧或只有半个帧
+            processFrames(session, chunk, static_cast<size_t>(received));
+        } else if (!session.closeAfterWrite) {
+            session.readBuffer.append(chunk, static_cast<size_t>(received));
 
-        // 在新线程中处理客户端
-        std::thread([this, clientSocket, clientIP = std::string(clientIP)]() {
-            mMod->getSelf().getLogger().trace("Starting client handler thread for {}", clientIP);
-            handleClient(clientSocket);
-        }).detach();
+            bool complete = false;
+            if (!performHandshake(session, complete)) {
+                mLogger.warn("WebSocket handshake failed for {}", session.peer);
+                mMetrics.handshakeFailures.add();
+                session.closing = true;
+                return;
+            }
+            if (complete) {
+                onHandshakeComplete(session);
+            }
+        }
+
+        if (static_cast<size_t>(received) < sizeof(chunk)) {
+            break;
+        }
     }
-    mMod->getSelf().getLogger().debug("Accept loop ended");
 }
 
-void WebSocketServer::handleClient(SOCKET clientSocket) {
-    mMod->getSelf().getLogger().debug("Performing WebSocket handshake...");
-    
-    // 执行 WebSocket 握手
-    if (!performHandshake(clientSocket)) {
-        mMod->getSelf().getLogger().warn("WebSocket handshake failed for socket {}", static_cast<int>(clientSocket));
-        closesocket(clientSocket);
+void WebSocketServer::onHandshakeComplete(Session& session) {
+    mLogger.debug("WebSocket handshake successful");
+    session.state = Session::State::Open;
+    session.parser = FrameParser(MAX_PAYLOAD_SIZE, session.inflater != nullptr,
+                                 session.local ? Framing::LengthPrefixed : Framing::WebSocket);
+    session.queue = std::make_shared<SendQueue>(mQueueCapacity, mOverflowPolicy, &mMetrics.sendQueueDropped);
+    {
+        std::lock_guard<std::mutex> lock(mQueuesMutex);
+        ClientEntry entry;
+        entry.queue = session.queue;
+        entry.encoding = session.encoding;
+        entry.deflateWindowBits = session.deflate.enabled ? session.deflate.serverMaxWindowBits : 0;
+        entry.local = session.local;
+        mQueues.emplace(session.id, std::move(entry));
+        updateSubscribedTopicsLocked();
+    }
+    ++mClientCount;
+    if (session.encoding == MessageEncoding::MsgPack) {
+        ++mMsgPackClientCount;
+    }
+    mLogger.info("WebSocket client {} connected, total clients: {}", session.peer, mClientCount.load());
+
+    // 从握手完成开始计算心跳
+    session.lastPingSent = TimerWheel::Clock::now();
+    if (!session.timerScheduled) {
+        checkSession(session, session.lastPingSent);
+    }
+
+    // 客户端可能紧跟握手请求发送了帧，之后不再需要握手缓冲区
+    std::string pending;
+    pending.swap(session.readBuffer);
+    if (!pending.empty()) {
+        processFrames(session, pending.data(), pending.size());
+    }
+}
+
+void WebSocketServer::processFrames(Session& session, const char* data, size_t length) {
+    size_t offset = 0;
+    while (offset < length && !session.closing && !session.closeAfterWrite) {
+        offset += session.parser.feed(data + offset, length - offset);
+
+        switch (session.parser.status()) {
+        case FrameParser::Status::NeedMore:
+            break;
+        case FrameParser::Status::Ready:
+            handleFrame(session);
+            session.parser.next();
+            break;
+        case FrameParser::Status::Error:
+            MCWS_DEBUG(mLogger, "Invalid frame from {}, closing with status {}",
+                       session.peer, static_cast<int>(session.parser.errorCode()));
+            mMetrics.disconnects[static_cast<size_t>(DisconnectReason::ProtocolError)].add();
+            sendClose(session, session.parser.errorCode());
+            return;
+        }
+    }
+}
+
+void WebSocketServer::handleFrame(Session& session) {
+    std::string& payload = session.parser.payload();
+
+    size_t kind = static_cast<size_t>(frameKindFromOpcode(session.parser.opcode()));
+    mMetrics.framesIn[kind].add();
+    mMetrics.bytesIn[kind].add(payload.size());
+
+    switch (session.parser.opcode()) {
+    case 0x8: {
+        // 回应关闭帧 (带回对方的状态码)，写完后关闭连接
+        if (payload.size() == 1) {
+            sendClose(session, CloseCode::ProtocolError);
+            return;
+        }
+        uint16_t code = payload.size() >= 2 ? static_cast<uint16_t>((static_cast<unsigned char>(payload[0]) << 8)
+                                                                   | static_cast<unsigned char>(payload[1]))
+                                            : static_cast<uint16_t>(CloseCode::Normal);
+        MCWS_DEBUG(mLogger, "Close frame received from {} (status {})", session.peer, code);
+        // 不合法或保留的状态码不能原样带回；关闭原因必须是合法的 UTF-8
+        if (!isValidCloseCode(code)) {
+            sendClose(session, CloseCode::ProtocolError);
+        } else if (!isValidUtf8(std::string_view(payload).substr(std::min<size_t>(payload.size(), 2)))) {
+            sendClose(session, CloseCode::InvalidPayload);
+        } else {
+            sendClose(session, static_cast<CloseCode>(code));
+        }
         return;
     }
-    
-    mMod->getSelf().getLogger().debug("WebSocket handshake successful");
+    case 0x9:
+        // ping 原样回应 pong
+        queueSend(session, makeControlFrame(session.local, 0xA, std::move(payload)));
+        return;
+    case 0xA:
+        MCWS_TRACE(mLogger, "Pong received from {}", session.peer);
+        session.awaitingPong = false;
+        return;
+    default:
+        break;
+    }
 
-    // 添加到客户端列表
-    {
-        std::lock_guard<std::mutex> lock(mClientsMutex);
-        mClients.insert(clientSocket);
+    // 二进制帧只在协商了 MessagePack 子协议时有意义，文本帧始终按 JSON 处理
+    MessageEncoding encoding = MessageEncoding::Json;
+    if (session.parser.opcode() == 0x2) {
+        if (session.encoding != MessageEncoding::MsgPack) {
+            mMetrics.disconnects[static_cast<size_t>(DisconnectReason::ProtocolError)].add();
+            sendClose(session, CloseCode::UnsupportedData);
+            return;
+        }
+        encoding = MessageEncoding::MsgPack;
     }
 
-    mMod->getSelf().getLogger().info("WebSocket client connected, total clients: {}", mClients.size());
+    // 超出速率的消息在解压和解析之前丢弃，恢复放行时汇总记录丢弃的条数
+    if (!session.inboundBucket.tryAcquire(mInboundRateLimit)) {
+        if (session.inboundSuppressed++ == 0) {
+            mLogger.warn("Client {} exceeded the message rate limit, dropping messages", session.peer);
+        }
+        mMetrics.inboundRateLimited.add();
+        return;
+    }
+    if (session.inboundSuppressed > 0) {
+        mLogger.info("{} messages from client {} suppressed by the rate limit", session.inboundSuppressed,
+                     session.peer);
+        session.inboundSuppressed = 0;
+    }
 
-    // 接收消息循环
-    mMod->getSelf().getLogger().trace("Entering message receive loop for socket {}", static_cast<int>(clientSocket));
-    while (mRunning) {
-        std::string message = receiveFrame(clientSocket);
-        if (message.empty()) {
-            mMod->getSelf().getLogger().debug("Empty message received, connection may be closed");
-            break; // 连接关闭或错误
+    // 解压消息（如果有压缩）
+    std::string inflated;
+    if (session.parser.compressed()) {
+        if (!session.inflater->decompress(payload.data(), payload.size(), inflated, MAX_PAYLOAD_SIZE)) {
+            sendClose(session, inflated.size() >= MAX_PAYLOAD_SIZE ? CloseCode::MessageTooBig : CloseCode::InvalidPayload);
+            return;
         }
+    }
+    const std::string& message = session.parser.compressed() ? inflated : payload;
 
-        mMod->getSelf().getLogger().debug("Received WebSocket message ({} bytes): {}", message.length(), message);
-        
-        if (mMessageCallback) {
-            try {
-                mMod->getSelf().getLogger().trace("Invoking message callback...");
-                mMessageCallback(message);
-            } catch (const std::exception& e) {
-                mMod->getSelf().getLogger().error("Error in message callback: {}", e.what());
+    if (message.empty()) {
+        MCWS_DEBUG(mLogger, "Empty message received from {}, ignoring", session.peer);
+        return;
+    }
+
+    if (encoding == MessageEncoding::Json) {
+        MCWS_DEBUG(mLogger, "Received WebSocket message ({} bytes): {}", message.length(), message);
+    } else {
+        MCWS_DEBUG(mLogger, "Received binary WebSocket message ({} bytes)", message.length());
+    }
+
+    // resume / subscribe / hello 由服务器处理，不交给消息回调
+    nlohmann::json control = parseControlMessage(message, encoding);
+    if (!control.is_discarded()) {
+        if (control["type"] == "hello") {
+            auto features = control.find("features");
+            if (features != control.end() && features->is_array()
+                && std::find(features->begin(), features->end(), "player_ids") != features->end()) {
+                enablePlayerIds(session);
             }
+        } else if (control["type"] == "subscribe") {
+            std::vector<std::string> unknownEvents;
+            auto subscription = parseSubscription(control, unknownEvents);
+            for (const auto& name : unknownEvents) {
+                mLogger.warn("Client {} subscribed to unknown event type {}", session.peer, name);
+            }
+            setSubscription(session, std::move(subscription));
+        } else if (mJournal) {
+            auto seq = control.find("last_seq");
+            startReplay(session, seq != control.end() && seq->is_number_unsigned() ? seq->get<uint64_t>() : 0);
         } else {
-            mMod->getSelf().getLogger().warn("No message callback set, ignoring message");
+            mLogger.warn("Client {} requested resume but the event journal is disabled", session.peer);
         }
+        return;
     }
+    
+    if (mMessageCallback) {
+        try {
+            MCWS_TRACE(mLogger, "Invoking message callback...");
+            mMessageCallback(message, encoding);
+        } catch (const std::exception& e) {
+            mLogger.error("Error in message callback: {}", e.what());
+        }
+    } else {
+        mLogger.warn("No message callback set, ignoring message");
+    }
+}
 
-    // 从客户端列表中移除
+void WebSocketServer::setSubscription(Session& session, std::shared_ptr<const Subscription> subscription) {
     {
-        std::lock_guard<std::mutex> lock(mClientsMutex);
-        mClients.erase(clientSocket);
+        std::lock_guard<std::mutex> lock(mQueuesMutex);
+        auto it = mQueues.find(session.id);
+        if (it == mQueues.end()) {
+            return;
+        }
+        it->second.subscription = subscription;
+        it->second.telemetrySynced = false;
+        updateSubscribedTopicsLocked();
     }
+    session.subscription = subscription;
 
-    closesocket(clientSocket);
-    mMod->getSelf().getLogger().info("WebSocket client disconnected, remaining clients: {}", mClients.size());
+    if (!subscription) {
+        mLogger.info("Client {} subscribed to the default events", session.peer);
+        return;
+    }
+    std::string topics;
+    for (size_t i = 0; i < EventTypeCount; ++i) {
+        if (subscription->topics & topicBit(static_cast<EventType>(i))) {
+            topics += topics.empty() ? "" : ", ";
+            topics += EventTypeNames[i];
+        }
+    }
+    mLogger.info("Client {} subscribed to [{}]{}", session.peer, topics,
+                 subscription->players.empty() ? std::string()
+                                               : fmt::format(" for {} players", subscription->players.size()));
 }
 
-bool WebSocketServer::performHandshake(SOCKET clientSocket) {
-    mMod->getSelf().getLogger().trace("Reading handshake request...");
-    
-    char buffer[4096];
-    int bytesReceived = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
-    
-    if (bytesReceived <= 0) {
-        mMod->getSelf().getLogger().debug("No data received during handshake");
-        return false;
+void WebSocketServer::enablePlayerIds(Session& session) {
+    {
+        std::lock_guard<std::mutex> lock(mQueuesMutex);
+        auto it = mQueues.find(session.id);
+        if (it == mQueues.end()) {
+            return;
+        }
+        it->second.playerIds = true;
+        it->second.playerIdsSynced = false;
+        std::optional<FrameSet> mapping;
+        syncPlayerIdsLocked(it->second, mapping);
     }
-    
-    mMod->getSelf().getLogger().trace("Received {} bytes for handshake", bytesReceived);
-    
-    buffer[bytesReceived] = '\0';
-    std::string request(buffer);
+    requestWakeup();
 
-    // 检查是否是 HTTP GET 请求
-    if (request.find("GET ") != 0) {
-        return false;
+    if (!session.playerIds) {
+        session.playerIds = true;
+        ++mPlayerIdClientCount;
+        mLogger.info("Client {} enabled player IDs", session.peer);
     }
+}
 
-    // 查找 Sec-WebSocket-Key
-    std::string keyHeader = "Sec-WebSocket-Key: ";
-    size_t keyPos = request.find(keyHeader);
-    if (keyPos == std::string::npos) {
-        return false;
+void WebSocketServer::updateSubscribedTopicsLocked() {
+    uint32_t topics = 0;
+    for (const auto& [id, client] : mQueues) {
+        topics |= client.subscription ? client.subscription->topics : DefaultTopics;
     }
+    mSubscribedTopics.store(topics, std::memory_order_relaxed);
+}
 
-    size_t keyStart = keyPos + keyHeader.length();
-    size_t keyEnd = request.find("\r\n", keyStart);
-    if (keyEnd == std::string::npos) {
-        return false;
+void WebSocketServer::startReplay(Session& session, uint64_t lastSeq) {
+    {
+        std::lock_guard<std::mutex> lock(mQueuesMutex);
+        auto it = mQueues.find(session.id);
+        if (it == mQueues.end()) {
+            return;
+        }
+        it->second.replaying = true;
     }
 
-    std::string clientKey = request.substr(keyStart, keyEnd - keyStart);
-    std::string acceptKey = computeAcceptKey(clientKey);
+    uint64_t first = mJournal->firstSeq();
+    uint64_t last = mJournal->lastSeq();
+    // 客户端的序号比日志还新 (日志被清空或重新开启、客户端出错等): 按日志的最新序号处理，
+    // 否则重放结束后 replayedThrough 过大，之后的广播在序号追上之前都会被当作已重放而跳过
+    if (lastSeq > last) {
+        mLogger.warn("Client {} requested resume after seq {} but the journal ends at {}, resuming from there",
+                     session.peer, lastSeq, last);
+        lastSeq = last;
+    }
 
-    // 构建响应
-    std::ostringstream response;
-    response << "HTTP/1.1 101 Switching Protocols\r\n";
-    response << "Upgrade: websocket\r\n";
-    response << "Connection: Upgrade\r\n";
-    response << "Sec-WebSocket-Accept: " << acceptKey << "\r\n";
-    response << "\r\n";
+    session.replaying = true;
+    session.replayCursor = EventJournal::Cursor{};
+    session.replayCursor.seq = lastSeq + 1;
 
-    std::string responseStr = response.str();
-    int bytesSent = send(clientSocket, responseStr.c_str(), static_cast<int>(responseStr.length()), 0);
-    
-    return bytesSent == static_cast<int>(responseStr.length());
+    mLogger.info("Client {} resuming after seq {} (journal holds {}-{})", session.peer, lastSeq, first, last);
+    if (lastSeq + 1 < first && lastSeq < last) {
+        mLogger.warn("Events {}-{} requested by {} are no longer in the journal", lastSeq + 1, first - 1, session.peer);
+    }
+
+    pumpReplay(session);
+    if (!session.wantWrite) {
+        onWritable(session);
+    }
 }
 
-bool WebSocketServer::sendFrame(SOCKET clientSocket, const std::string& message) {
-    std::vector<unsigned char> frame;
-    
-    // FIN + Text frame opcode
-    frame.push_back(0x81);
-    
-    size_t length = message.length();
-    
-    if (length <= 125) {
-        frame.push_back(static_cast<unsigned char>(length));
-    } else if (length <= 65535) {
-        frame.push_back(126);
-        frame.push_back(static_cast<unsigned char>((length >> 8) & 0xFF));
-        frame.push_back(static_cast<unsigned char>(length & 0xFF));
-    } else {
-        frame.push_back(127);
-        for (int i = 7; i >= 0; --i) {
-            frame.push_back(static_cast<unsigned char>((length >> (i * 8)) & 0xFF));
+void WebSocketServer::pumpReplay(Session& session) {
+    // 每批最多填到半个队列，写完后由 onWritable 继续，重放不会挤占队列或触发溢出
+    const size_t limit = std::max<size_t>(mQueueCapacity / 2, 1);
+    std::vector<std::string> records;
+    std::vector<FrameSet> frames;
+
+    while (session.replaying) {
+        size_t queued = session.queue->size();
+        if (queued >= limit) {
+            return;
+        }
+
+        records.clear();
+        size_t count = mJournal->read(session.replayCursor, limit - queued, records);
+
+        frames.clear();
+        for (auto& record : records) {
+            // 日志中只保存 JSON，需要按订阅过滤或 MessagePack 客户端重放时再解析
+            EncodedMessage message;
+            bool binary = session.encoding == MessageEncoding::MsgPack;
+            if (binary || session.subscription) {
+                nlohmann::json json = nlohmann::json::parse(record, nullptr, false);
+                if (json.is_discarded()) {
+                    continue;
+                }
+                EventType type;
+                if (session.subscription && json.contains("type") && json["type"].is_string()
+                    && parseEventType(json["type"].get_ref<const std::string&>(), type)
+                    && !session.subscription->matches(topicBit(type), json.value("player_name", std::string()))) {
+                    continue;
+                }
+                if (binary) {
+                    std::vector<std::uint8_t> packed = nlohmann::json::to_msgpack(json);
+                    message.msgpack.assign(packed.begin(), packed.end());
+                }
+            }
+            message.json = std::move(record);
+            frames.push_back(makeFrameSet(std::move(message)));
+        }
+
+        std::lock_guard<std::mutex> lock(mQueuesMutex);
+        auto it = mQueues.find(session.id);
+        if (it == mQueues.end()) {
+            return;
+        }
+        for (auto& frameSet : frames) {
+            if (const FrameRef* frame = selectFrameLocked(frameSet, it->second)) {
+                session.queue->push(*frame);
+            }
+        }
+        mMetrics.eventsReplayed.add(count);
+
+        // 日志中已没有更新的事件: 在持有队列锁时切回广播，
+        // 此后入队的广播要么已被重放 (按序号跳过)，要么尚未提交 (正常接收)
+        if (count == 0 && mJournal->lastSeq() < session.replayCursor.seq) {
+            it->second.replaying = false;
+            it->second.replayedThrough = session.replayCursor.seq - 1;
+            // 重放的是完整编码，之后的紧凑编码事件之前先重新发送映射
+            it->second.playerIdsSynced = false;
+            session.replaying = false;
+            mLogger.debug("Replay to {} caught up at seq {}", session.peer, session.replayCursor.seq - 1);
         }
     }
-    
-    // 添加消息内容
-    frame.insert(frame.end(), message.begin(), message.end());
-    
-    int bytesSent = send(clientSocket, reinterpret_cast<const char*>(frame.data()), static_cast<int>(frame.size()), 0);
-    return bytesSent == static_cast<int>(frame.size());
 }
 
-std::string WebSocketServer::receiveFrame(SOCKET clientSocket) {
-    unsigned char header[2];
-    int bytesReceived = recv(clientSocket, reinterpret_cast<char*>(header), 2, 0);
-    
-    if (bytesReceived != 2) {
-        return "";
-    }
+void WebSocketServer::sendClose(Session& session, CloseCode code) {
+    std::string payload;
+    payload.push_back(static_cast<char>((static_cast<uint16_t>(code) >> 8) & 0xFF));
+    payload.push_back(static_cast<char>(static_cast<uint16_t>(code) & 0xFF));
+    closeAfterFlush(session);
+    queueSend(session, makeControlFrame(session.local, 0x8, std::move(payload)));
+}
+
+void WebSocketServer::closeAfterFlush(Session& session) {
+    session.closeAfterWrite = true;
+    session.closeSentAt = TimerWheel::Clock::now();
+    mTimers.schedule(session.id, session.closeSentAt + CLOSE_TIMEOUT);
+    session.timerScheduled = true;
+}
+
+void WebSocketServer::onWritable(Session& session) {
+    // 同一次调用中写完的帧共用一个时间戳
+    TimerWheel::Clock::time_point writtenAt{};
+    while (true) {
+        // 当前帧都写完后，从发送队列取出下一批帧
+        if (session.writeIndex >= session.writeFrames.size()) {
+            session.writeFrames.clear();
+            session.writeIndex = 0;
+            session.writeOffset = 0;
+            // 关闭帧之后不再发送任何数据
+            if (session.closeAfterWrite) {
+                session.closing = true;
+                return;
+            }
+            if (!session.queue) {
+                break;
+            }
+            if (session.queue->popAll(session.writeFrames) == 0) {
+                // 重放中的连接在上一批写完后继续从日志读取
+                if (!session.replaying) {
+                    break;
+                }
+                pumpReplay(session);
+                if (session.queue->popAll(session.writeFrames) == 0) {
+                    break;
+                }
+            }
+        }
+
+        // 把待写出的帧头和负载组装成分散写分段，不做任何拷贝
+        IoSlice slices[MaxIoSlices];
+        size_t count = 0;
+        size_t skip = session.writeOffset;
+        for (size_t i = session.writeIndex; i < session.writeFrames.size() && count + 2 <= MaxIoSlices; ++i) {
+            const OutboundFrame& frame = *session.writeFrames[i];
+            if (skip < frame.headerSize()) {
+                slices[count++] = {frame.header() + skip, frame.headerSize() - skip};
+                skip = 0;
+            } else {
+                skip -= frame.headerSize();
+            }
+            if (skip < frame.payload().size()) {
+                slices[count++] = {frame.payload().data() + skip, frame.payload().size() - skip};
+            }
+            skip = 0;
+        }
 
-    // 检查是否是关闭帧
-    unsigned char opcode = header[0] & 0x0F;
-    if (opcode == 0x08) {
-        return ""; // 连接关闭
+        size_t remaining = 0;
+        if (count > 0) {
+            int64_t sent = sendVector(session.socket, slices, count);
+            if (sent < 0) {
+                mLogger.debug("Failed to send to client, marking for removal");
+                session.closing = true;
+                return;
+            }
+            if (sent == 0) {
+                break; // 发送缓冲区已满，等待下一次可写
+            }
+            remaining = static_cast<size_t>(sent);
+        }
+
+        // 按已写出的字节数推进，写完的帧立即释放引用
+        while (session.writeIndex < session.writeFrames.size()) {
+            const OutboundFrame& frame = *session.writeFrames[session.writeIndex];
+            size_t frameLeft = frame.size() - session.writeOffset;
+            if (remaining < frameLeft) {
+                session.writeOffset += remaining;
+                break;
+            }
+            remaining -= frameLeft;
+
+            FrameKind kind = frameKindFromOpcode(frame.opcode());
+            mMetrics.framesOut[static_cast<size_t>(kind)].add();
+            mMetrics.bytesOut[static_cast<size_t>(kind)].add(frame.payload().size());
+            if (kind == FrameKind::Text || kind == FrameKind::Binary) {
+                if (writtenAt == TimerWheel::Clock::time_point{}) {
+                    writtenAt = TimerWheel::Clock::now();
+                }
+                mMetrics.sendLatency.observe(writtenAt - frame.createdAt());
+            }
+            session.writeFrames[session.writeIndex].reset();
+            ++session.writeIndex;
+            session.writeOffset = 0;
+        }
     }
 
-    bool masked = (header[1] & 0x80) != 0;
-    uint64_t payloadLength = header[1] & 0x7F;
+    updateInterest(session);
+}
+
+void WebSocketServer::flushQueues() {
+    std::vector<uint64_t> disconnected;
 
-    if (payloadLength == 126) {
-        unsigned char extLength[2];
-        if (recv(clientSocket, reinterpret_cast<char*>(extLength), 2, 0) != 2) {
-            return "";
+    for (auto& [id, session] : mSessions) {
+        if (!session->queue || session->closing) {
+            continue;
         }
-        payloadLength = (static_cast<uint64_t>(extLength[0]) << 8) | extLength[1];
-    } else if (payloadLength == 127) {
-        unsigned char extLength[8];
-        if (recv(clientSocket, reinterpret_cast<char*>(extLength), 8, 0) != 8) {
-            return "";
+        if (session->queue->shouldDisconnect()) {
+            mLogger.warn("Send queue of {} overflowed, disconnecting", session->peer);
+            mMetrics.disconnects[static_cast<size_t>(DisconnectReason::QueueOverflow)].add();
+            session->closing = true;
+        } else if (!session->wantWrite && session->queue->size() > 0) {
+            onWritable(*session);
         }
-        payloadLength = 0;
-        for (int i = 0; i < 8; ++i) {
-            payloadLength = (payloadLength << 8) | extLength[i];
+        if (session->closing) {
+            disconnected.push_back(id);
         }
     }
 
-    // 读取掩码（如果有）
-    unsigned char mask[4] = {0};
-    if (masked) {
-        if (recv(clientSocket, reinterpret_cast<char*>(mask), 4, 0) != 4) {
-            return "";
+    // 移除发送失败或溢出的连接
+    for (uint64_t id : disconnected) {
+        closeSession(id);
+    }
+    if (!disconnected.empty()) {
+        mLogger.debug("Removed {} disconnected clients, {} remaining", 
+                      disconnected.size(), mClientCount.load());
+    }
+}
+
+void WebSocketServer::queueSend(Session& session, FrameRef frame) {
+    session.writeFrames.push_back(std::move(frame));
+    if (!session.wantWrite) {
+        onWritable(session);
+    }
+}
+
+void WebSocketServer::updateInterest(Session& session) {
+    bool wantWrite = session.writeIndex < session.writeFrames.size();
+    if (wantWrite == session.wantWrite || session.closing) {
+        return;
+    }
+    session.wantWrite = wantWrite;
+    mPoller.modify(session.socket, session.id, Poller::Readable | (wantWrite ? Poller::Writable : 0u));
+}
+
+void WebSocketServer::closeSession(uint64_t id) {
+    auto it = mSessions.find(id);
+    if (it == mSessions.end()) {
+        return;
+    }
+
+    Session& session = *it->second;
+    if (session.queue) {
+        std::lock_guard<std::mutex> lock(mQueuesMutex);
+        mQueues.erase(session.id);
+        updateSubscribedTopicsLocked();
+    }
+    mPoller.remove(session.socket);
+    closeSocket(session.socket);
+
+    bool wasOpen = session.state == Session::State::Open;
+    mSessions.erase(it);
+    if (wasOpen) {
+        --mClientCount;
+        if (session.encoding == MessageEncoding::MsgPack) {
+            --mMsgPackClientCount;
+        }
+        if (session.playerIds) {
+            --mPlayerIdClientCount;
         }
+        mLogger.info("WebSocket client disconnected, remaining clients: {}", mClientCount.load());
     }
+}
 
-    // 读取负载
-    if (payloadLength > 1024 * 1024) { // 限制最大 1MB
-        return "";
+bool WebSocketServer::performHandshake(Session& session, bool& complete) {
+    if (session.local) {
+        return performLocalHandshake(session, complete);
     }
 
-    std::vector<char> payload(static_cast<size_t>(payloadLength));
-    size_t totalReceived = 0;
+    MCWS_TRACE(mLogger, "Reading handshake request...");
+    
+    complete = false;
+    size_t headerEnd = session.readBuffer.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) {
+        // 请求头尚未接收完整
+        return session.readBuffer.size() < MAX_HANDSHAKE_SIZE;
+    }
+    
+    MCWS_TRACE(mLogger, "Received {} bytes for handshake", headerEnd + 4);
     
-    while (totalReceived < payloadLength) {
-        int remaining = static_cast<int>(payloadLength - totalReceived);
-        int received = recv(clientSocket, payload.data() + totalReceived, remaining, 0);
-        if (received <= 0) {
-            return "";
+    std::string request = session.readBuffer.substr(0, headerEnd + 4);
+    session.readBuffer.erase(0, headerEnd + 4);
+
+    // 检查是否是 HTTP GET 请求
+    if (request.find("GET ") != 0) {
+        return false;
+    }
+
+    // 查找 Sec-WebSocket-Key，没有时按普通 HTTP 请求处理 (/metrics、/healthz)
+    std::string clientKey = getHeaderValue(request, "Sec-WebSocket-Key");
+    if (clientKey.empty()) {
+        return mMetricsEnabled && handleHttpRequest(session, request);
+    }
+
+    std::string acceptKey = computeAcceptKey(clientKey);
+
+    // 协商 permessage-deflate
+    std::string extensionResponse;
+    if (mDeflateEnabled) {
+        std::string offer = getHeaderValue(request, "Sec-WebSocket-Extensions");
+        if (!offer.empty()
+            && negotiatePerMessageDeflate(offer, mDeflateClientNoContextTakeover, session.deflate, extensionResponse)) {
+            session.inflater = std::make_unique<DeflateDecompressor>(session.deflate.clientNoContextTakeover);
+            mLogger.debug("Negotiated {}", extensionResponse);
         }
-        totalReceived += received;
     }
 
-    // 解码消息（如果有掩码）
-    if (masked) {
-        for (size_t i = 0; i < payloadLength; ++i) {
-            payload[i] ^= mask[i % 4];
+    // 协商子协议: 客户端按优先级列出，选择第一个支持的
+    if (mMsgPackEnabled) {
+        std::string protocols = getHeaderValue(request, "Sec-WebSocket-Protocol");
+        size_t start = 0;
+        while (start < protocols.size()) {
+            size_t end = protocols.find(',', start);
+            if (end == std::string::npos) {
+                end = protocols.size();
+            }
+            size_t first = protocols.find_first_not_of(" \t", start);
+            size_t last = protocols.find_last_not_of(" \t", end - 1);
+            if (first < end && protocols.compare(first, last - first + 1, MsgPackSubprotocol) == 0) {
+                session.encoding = MessageEncoding::MsgPack;
+                mLogger.debug("Negotiated subprotocol {}", MsgPackSubprotocol);
+                break;
+            }
+            start = end + 1;
         }
     }
 
-    return std::string(payload.begin(), payload.end());
-}
+    // 构建响应
+    std::ostringstream response;
+    response << "HTTP/1.1 101 Switching Protocols\r\n";
+    response << "Upgrade: websocket\r\n";
+    response << "Connection: Upgrade\r\n";
+    response << "Sec-WebSocket-Accept: " << acceptKey << "\r\n";
+    if (session.encoding == MessageEncoding::MsgPack) {
+        response << "Sec-WebSocket-Protocol: " << MsgPackSubprotocol << "\r\n";
+    }
+    if (!extensionResponse.empty()) {
+        response << "Sec-WebSocket-Extensions: " << extensionResponse << "\r\n";
+    }
+    response << "\r\n";
 
-std::string WebSocketServer::computeAcceptKey(const std::string& clientKey) {
-    std::string combined = clientKey + WS_GUID;
-    
-    unsigned char hash[20];
-    sha1(combined, hash);
-    
-    return base64Encode(hash, 20);
+    queueSend(session, OutboundFrame::raw(response.str()));
+    complete = true;
+    return !session.closing;
 }
 
-// 简单的 SHA1 实现
-void WebSocketServer::sha1(const std::string& input, unsigned char output[20]) {
-    uint32_t h0 = 0x67452301;
-    uint32_t h1 = 0xEFCDAB89;
-    uint32_t h2 = 0x98BADCFE;
-    uint32_t h3 = 0x10325476;
-    uint32_t h4 = 0xC3D2E1F0;
+bool WebSocketServer::performLocalHandshake(Session& session, bool& complete) {
+    complete = false;
+    size_t lineEnd = session.readBuffer.find('\n');
+    if (lineEnd == std::string::npos) {
+        return session.readBuffer.size() < MAX_LOCAL_PROTOCOL_LINE;
+    }
 
-    // 填充消息
-    std::vector<unsigned char> msg(input.begin(), input.end());
-    uint64_t originalBitLen = msg.size() * 8;
-    
-    msg.push_back(0x80);
-    while ((msg.size() % 64) != 56) {
-        msg.push_back(0x00);
+    std::string protocol = session.readBuffer.substr(0, lineEnd);
+    session.readBuffer.erase(0, lineEnd + 1);
+    if (!protocol.empty() && protocol.back() == '\r') {
+        protocol.pop_back();
     }
-    
-    for (int i = 7; i >= 0; --i) {
-        msg.push_back(static_cast<unsigned char>((originalBitLen >> (i * 8)) & 0xFF));
+
+    // 没有握手响应: 服务器未开启 MessagePack 时退回 JSON，客户端可以从帧的 opcode 得知
+    if (protocol == MsgPackSubprotocol) {
+        session.encoding = mMsgPackEnabled ? MessageEncoding::MsgPack : MessageEncoding::Json;
+    } else if (protocol != JsonLocalProtocol) {
+        MCWS_DEBUG(mLogger, "Unknown local protocol from {}: {}", session.peer, protocol);
+        return false;
+    }
+    MCWS_DEBUG(mLogger, "Local client {} uses {}", session.peer,
+               session.encoding == MessageEncoding::MsgPack ? MsgPackSubprotocol : JsonLocalProtocol);
+    complete = true;
+    return true;
+}
+
+bool WebSocketServer::handleHttpRequest(Session& session, const std::string& request) {
+    // 请求行: GET <path>[?query] HTTP/1.1
+    size_t pathStart = 4;
+    size_t pathEnd = request.find_first_of(" ?\r", pathStart);
+    if (pathEnd == std::string::npos) {
+        return false;
     }
+    std::string path = request.substr(pathStart, pathEnd - pathStart);
 
-    // 处理每个 512 位块
-    for (size_t chunk = 0; chunk < msg.size(); chunk += 64) {
-        uint32_t w[80];
-        
-        for (int i = 0; i < 16; ++i) {
-            w[i] = (static_cast<uint32_t>(msg[chunk + i * 4]) << 24) |
-                   (static_cast<uint32_t>(msg[chunk + i * 4 + 1]) << 16) |
-                   (static_cast<uint32_t>(msg[chunk + i * 4 + 2]) << 8) |
-                   (static_cast<uint32_t>(msg[chunk + i * 4 + 3]));
+    if (path == "/metrics") {
+        mMetrics.httpRequests.add();
+        // 指标包含连接数、队列深度和流量，默认不对外暴露
+        if (!session.loopback && !mMetricsAllowRemote) {
+            sendHttpResponse(session, "403 Forbidden", "text/plain; charset=utf-8", "forbidden\n");
+            return true;
         }
-        
-        for (int i = 16; i < 80; ++i) {
-            uint32_t temp = w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16];
-            w[i] = (temp << 1) | (temp >> 31);
-        }
-
-        uint32_t a = h0, b = h1, c = h2, d = h3, e = h4;
-
-        for (int i = 0; i < 80; ++i) {
-            uint32_t f, k;
-            if (i < 20) {
-                f = (b & c) | ((~b) & d);
-                k = 0x5A827999;
-            } else if (i < 40) {
-                f = b ^ c ^ d;
-                k = 0x6ED9EBA1;
-            } else if (i < 60) {
-                f = (b & c) | (b & d) | (c & d);
-                k = 0x8F1BBCDC;
-            } else {
-                f = b ^ c ^ d;
-                k = 0xCA62C1D6;
-            }
-
-            uint32_t temp = ((a << 5) | (a >> 27)) + f + e + k + w[i];
-            e = d;
-            d = c;
-            c = (b << 30) | (b >> 2);
-            b = a;
-            a = temp;
-        }
-
-        h0 += a;
-        h1 += b;
-        h2 += c;
-        h3 += d;
-        h4 += e;
-    }
-
-    // 输出哈希值
-    output[0] = static_cast<unsigned char>((h0 >> 24) & 0xFF);
-    output[1] = static_cast<unsigned char>((h0 >> 16) & 0xFF);
-    output[2] = static_cast<unsigned char>((h0 >> 8) & 0xFF);
-    output[3] = static_cast<unsigned char>(h0 & 0xFF);
-    output[4] = static_cast<unsigned char>((h1 >> 24) & 0xFF);
-    output[5] = static_cast<unsigned char>((h1 >> 16) & 0xFF);
-    output[6] = static_cast<unsigned char>((h1 >> 8) & 0xFF);
-    output[7] = static_cast<unsigned char>(h1 & 0xFF);
-    output[8] = static_cast<unsigned char>((h2 >> 24) & 0xFF);
-    output[9] = static_cast<unsigned char>((h2 >> 16) & 0xFF);
-    output[10] = static_cast<unsigned char>((h2 >> 8) & 0xFF);
-    output[11] = static_cast<unsigned char>(h2 & 0xFF);
-    output[12] = static_cast<unsigned char>((h3 >> 24) & 0xFF);
-    output[13] = static_cast<unsigned char>((h3 >> 16) & 0xFF);
-    output[14] = static_cast<unsigned char>((h3 >> 8) & 0xFF);
-    output[15] = static_cast<unsigned char>(h3 & 0xFF);
-    output[16] = static_cast<unsigned char>((h4 >> 24) & 0xFF);
-    output[17] = static_cast<unsigned char>((h4 >> 16) & 0xFF);
-    output[18] = static_cast<unsigned char>((h4 >> 8) & 0xFF);
-    output[19] = static_cast<unsigned char>(h4 & 0xFF);
-}
-
-std::string WebSocketServer::base64Encode(const unsigned char* data, size_t length) {
-    static const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    
-    std::string result;
-    result.reserve(((length + 2) / 3) * 4);
+        sendHttpResponse(session, "200 OK", "text/plain; version=0.0.4; charset=utf-8", renderMetrics());
+        return true;
+    }
+    if (path == "/healthz") {
+        mMetrics.httpRequests.add();
+        sendHttpResponse(session, "200 OK", "text/plain; charset=utf-8", "ok\n");
+        return true;
+    }
+    sendHttpResponse(session, "404 Not Found", "text/plain; charset=utf-8", "not found\n");
+    return true;
+}
+
+void WebSocketServer::sendHttpResponse(Session& session, const char* status, const char* contentType,
+                                       const std::string& body) {
+    MCWS_DEBUG(mLogger, "HTTP {} for {}", status, session.peer);
+
+    std::string response;
+    response.reserve(body.size() + 128);
+    response.append("HTTP/1.1 ").append(status).append("\r\n");
+    response.append("Content-Type: ").append(contentType).append("\r\n");
+    response.append("Content-Length: ").append(std::to_string(body.size())).append("\r\n");
+    response.append("Cache-Control: no-store\r\n");
+    response.append("Connection: close\r\n\r\n");
+    response.append(body);
 
-    for (size_t i = 0; i < length; i += 3) {
-        unsigned int n = static_cast<unsigned int>(data[i]) << 16;
-        if (i + 1 < length) n |= static_cast<unsigned int>(data[i + 1]) << 8;
-        if (i + 2 < length) n |= static_cast<unsigned int>(data[i + 2]);
+    closeAfterFlush(session);
+    queueSend(session, OutboundFrame::raw(std::move(response)));
+}
 
-        result += chars[(n >> 18) & 0x3F];
-        result += chars[(n >> 12) & 0x3F];
-        result += (i + 1 < length) ? chars[(n >> 6) & 0x3F] : '=';
-        result += (i + 2 < length) ? chars[n & 0x3F] : '=';
+std::string WebSocketServer::renderMetrics() const {
+    // 瞬时值直接从事件循环线程持有的连接表统计
+    size_t handshaking = 0;
+    size_t queuedFrames = 0;
+    size_t maxQueuedFrames = 0;
+    size_t pending = 0;
+    size_t slowConsumers = 0;
+    size_t localClients = 0;
+    for (const auto& [id, session] : mSessions) {
+        if (session->state == Session::State::Handshake) {
+            ++handshaking;
+            continue;
+        }
+        if (session->local) {
+            ++localClients;
+        }
+        size_t queued = session->queue ? session->queue->size() : 0;
+        queuedFrames += queued;
+        maxQueuedFrames = std::max(maxQueuedFrames, queued);
+        pending += pendingBytes(*session);
+        if (session->slow) {
+            ++slowConsumers;
+        }
     }
 
-    return result;
+    std::string out;
+    out.reserve(8192);
+    auto header = [&out](const char* name, const char* help) {
+        out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+        out.append("# TYPE ").append(name).append(" gauge\n");
+    };
+    auto sample = [&out](const char* name, const char* labels, size_t value) {
+        out.append(name).append(labels).append(" ").append(std::to_string(value)).append("\n");
+    };
+
+    size_t clients = mClientCount.load();
+    size_t msgpackClients = std::min(mMsgPackClientCount.load(), clients);
+    header("mclistener_connected_clients", "Clients that completed the WebSocket handshake.");
+    sample("mclistener_connected_clients", "{encoding=\"json\"}", clients - msgpackClients);
+    sample("mclistener_connected_clients", "{encoding=\"msgpack\"}", msgpackClients);
+    header("mclistener_local_clients", "Connected clients using the local (Unix domain socket) transport.");
+    sample("mclistener_local_clients", "", localClients);
+    header("mclistener_pending_handshakes", "Connections that have not completed the handshake.");
+    sample("mclistener_pending_handshakes", "", handshaking);
+    header("mclistener_send_queue_frames", "Frames waiting in all client send queues.");
+    sample("mclistener_send_queue_frames", "", queuedFrames);
+    header("mclistener_send_queue_max_frames", "Deepest client send queue.");
+    sample("mclistener_send_queue_max_frames", "", maxQueuedFrames);
+    header("mclistener_send_pending_bytes", "Bytes not yet written to client sockets.");
+    sample("mclistener_send_pending_bytes", "", pending);
+    header("mclistener_slow_consumers", "Clients currently above the slow consumer threshold.");
+    sample("mclistener_slow_consumers", "", slowConsumers);
+
+    mMetrics.render(out);
+    return out;
 }
 
 } // namespace mclistener_ws_server
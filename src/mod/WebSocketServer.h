@@ -1,37 +1,64 @@
 #pragma once
 
+#include "mod/Config.h"
+#include "mod/EventJournal.h"
+#include "mod/FrameParser.h"
+#include "mod/Log.h"
+#include "mod/Metrics.h"
+#include "mod/PerMessageDeflate.h"
+#include "mod/PlayerIdTable.h"
+#include "mod/Poller.h"
+#include "mod/SendQueue.h"
+#include "mod/Socket.h"
+#include "mod/Subscription.h"
+#include "mod/TimerWheel.h"
+#include "mod/TokenBucket.h"
+
+#include <chrono>
 #include <string>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <thread>
 #include <atomic>
-#include <set>
-
-// Windows headers
-#ifndef WIN32_LEAN_AND_MEAN
-#define WIN32_LEAN_AND_MEAN
-#endif
-#include <Windows.h>
-#include <WinSock2.h>
-#include <WS2tcpip.h>
-
-#pragma comment(lib, "Ws2_32.lib")
+#include <unordered_map>
+#include <vector>
 
 namespace mclistener_ws_server {
 
-// 前向声明
-class MclistenerWsServerMod;
-
 /**
  * 简单的 WebSocket 服务器实现
  * 用于与 koishi-plugin-mclistener-ws-client 通信
+ *
+ * 所有连接由单个事件循环线程 (reactor) 统一处理 accept、握手、读和写，
+ * 每个连接只占用少量缓冲区，而不是一个线程
+ *
+ * broadcast() 只把帧放入各客户端的有界发送队列，从不接触客户端 socket，
+ * 因此可以安全地在游戏线程中调用
+ *
+ * 只依赖 Config 和 Logger 接口，不依赖 LeviLamina，可以在 Linux 上独立编译、测试和压测
+ *
+ * 同一端口上的普通 HTTP 请求 GET /metrics (Prometheus 文本格式) 和 GET /healthz 由事件循环直接响应
+ *
+ * 可选的本机传输在 Unix 域 socket 上监听，连接由同一个事件循环、发送队列和广播扇出处理，
+ * 只是没有 HTTP 握手和心跳，帧为长度前缀格式 (见 Framing::LengthPrefixed)
+ *
+ * 发送 hello 声明支持 player_ids 的客户端收到事件的紧凑编码 (只带玩家 ID)，
+ * 并在需要时 (hello 之后、重放结束、发送队列丢帧) 先收到完整的 player_ids 映射
  */
 class WebSocketServer {
 public:
-    using MessageCallback = std::function<void(const std::string& message)>;
+    using MessageCallback = std::function<void(const std::string& message, MessageEncoding encoding)>;
 
-    WebSocketServer(const std::string& host, int port, MclistenerWsServerMod* mod);
+    // 使用 MessagePack 编码的子协议名 (Sec-WebSocket-Protocol)
+    static constexpr const char* MsgPackSubprotocol = "mclistener.msgpack.v1";
+
+    // 本机连接建立后客户端先发送一行协议名 (以 \n 结尾) 选择编码: JSON 或 MsgPackSubprotocol
+    static constexpr const char* JsonLocalProtocol = "mclistener.json.v1";
+
+    // config 和 logger 的生命周期需长于服务器
+    WebSocketServer(const std::string& host, int port, const Config& config, Logger& logger);
     ~WebSocketServer();
 
     // 禁止拷贝
@@ -44,52 +71,292 @@ public:
     // 停止服务器
     void stop();
 
-    // 广播消息给所有连接的客户端
-    void broadcast(const std::string& message);
+    // 广播消息给所有连接的客户端 (线程安全，只入队，实际发送由事件循环线程完成)
+    // 每个客户端收到与其协商编码对应的版本，缺少该编码的客户端跳过这条消息
+    void broadcast(EncodedMessage message);
+
+    // 批量广播多条消息，每条一个帧，一次入队和唤醒 (消息会被移走)
+    void broadcastBatch(std::vector<EncodedMessage>& messages);
 
-    // 设置消息回调
+    // 把多条消息合并为一个 JSON / MessagePack 数组广播
+    // 设置了订阅的客户端只收到其中匹配的元素，相同匹配结果的客户端共享同一帧
+    void broadcastArray(const std::vector<EncodedMessage>& messages);
+
+    // 广播一次遥测采样，只发给订阅了 telemetry 的客户端
+    // 新订阅、重放结束或发送队列丢过帧的客户端改为接收 makeKeyframe() 的结果 (最多构造一次)，
+    // 之后的增量都基于它们已收到的这一帧；makeKeyframe 为空表示 delta 本身就是关键帧
+    void broadcastTelemetry(EncodedMessage delta, const std::function<EncodedMessage()>& makeKeyframe);
+
+    // 设置消息回调 (在事件循环线程中调用)；需在 start() 之前设置
     void setMessageCallback(MessageCallback callback);
 
+    // 设置事件日志，客户端可通过 resume 消息重放断线期间的事件；需在 start() 之前设置
+    void setJournal(EventJournal* journal) { mJournal = journal; }
+
+    // 设置本机传输监听的 Unix 域 socket 路径，空字符串表示不监听；需在 start() 之前设置
+    void setLocalSocketPath(std::string path) { mLocalSocketPath = std::move(path); }
+
     // 检查服务器是否正在运行
     bool isRunning() const { return mRunning; }
 
+    // 当前已完成握手的客户端数量
+    size_t getClientCount() const { return mClientCount; }
+
+    // 是否有协商了 MessagePack 子协议的客户端，没有时广播方可以省去该编码
+    bool hasMsgPackClients() const { return mMsgPackClientCount > 0; }
+
+    // 是否有支持 player_ids 的客户端，没有时广播方可以省去紧凑编码
+    bool hasPlayerIdClients() const { return mPlayerIdClientCount > 0; }
+
+    // 玩家 ID 表，由广播方分配 ID，服务器据此向客户端发送映射
+    PlayerIdTable& getPlayerIds() { return mPlayerIds; }
+
+    // 是否有客户端订阅了该类型的事件，没有时广播方可以跳过序列化
+    bool hasSubscribers(EventType type) const {
+        return (mSubscribedTopics.load(std::memory_order_relaxed) & topicBit(type)) != 0;
+    }
+
+    // 运行指标 (任意线程可写入)
+    Metrics& getMetrics() { return mMetrics; }
+
 private:
-    // 接受连接的线程函数
-    void acceptLoop();
+    // 单个连接的状态，只由事件循环线程访问
+    struct Session {
+        enum class State { Handshake, Open };
+
+        uint64_t    id;
+        SocketHandle socket;
+        std::string peer;
+        bool        local = false; // 本机传输的连接: 长度前缀帧，握手只有一行协议名，不发送心跳
+        bool        loopback = false; // 对端在本机 (回环地址或本机传输)，可以访问 /metrics
+        State       state = State::Handshake;
+        std::string readBuffer; // 只在握手阶段使用，之后的数据直接交给 parser
+        FrameParser parser;
+        std::shared_ptr<SendQueue> queue;
+        MessageEncoding encoding = MessageEncoding::Json;
+        // 协商得到的 permessage-deflate 参数和入站解压器
+        DeflateParams deflate;
+        std::unique_ptr<DeflateDecompressor> inflater;
+        // 正在写出的帧 (握手响应或从发送队列取出的帧)
+        std::vector<FrameRef> writeFrames;
+        size_t      writeIndex  = 0; // 当前正在写出的帧下标
+        size_t      writeOffset = 0; // 当前帧内已写出的字节数
+        bool        wantWrite   = false;
+        bool        closing     = false;
+        bool        closeAfterWrite = false; // 已发出关闭帧，写完剩余数据后关闭连接
+        // 心跳和超时状态，由时间轮定期检查
+        TimerWheel::Clock::time_point connectedAt;
+        TimerWheel::Clock::time_point lastReceive;
+        TimerWheel::Clock::time_point lastPingSent;
+        TimerWheel::Clock::time_point slowSince;
+        TimerWheel::Clock::time_point closeSentAt;
+        bool        awaitingPong   = false;
+        bool        slow           = false; // 发送积压超过阈值
+        bool        timerScheduled = false; // 时间轮中是否已有该连接的检查
+        // resume 后正在从事件日志重放
+        bool        replaying = false;
+        EventJournal::Cursor replayCursor;
+        // subscribe 设置的订阅，nullptr 表示接收所有事件 (与 ClientEntry 中的相同)
+        std::shared_ptr<const Subscription> subscription;
+        bool        playerIds = false; // 已通过 hello 启用 player_ids
+        // 入站消息限流，inboundSuppressed 为恢复放行前已丢弃的条数
+        TokenBucket inboundBucket;
+        uint64_t    inboundSuppressed = 0;
+    };
+
+    // 广播方可见的客户端信息
+    struct ClientEntry {
+        std::shared_ptr<SendQueue> queue;
+        MessageEncoding encoding = MessageEncoding::Json;
+        int deflateWindowBits = 0; // 0 表示未启用压缩
+        bool local = false;        // 使用长度前缀帧
+        // 重放期间不接收广播 (这些事件都会从日志中重放)，
+        // 重放结束后跳过序号不大于 replayedThrough 的广播，避免重复
+        bool replaying = false;
+        uint64_t replayedThrough = 0;
+        std::shared_ptr<const Subscription> subscription;
+        // 已收到最近一次遥测采样，之后的增量可以直接解码；telemetryDrops 为当时发送队列的丢帧数
+        bool telemetrySynced = false;
+        uint64_t telemetryDrops = 0;
+        // 接收紧凑编码；playerIdsSynced 表示已收到最新的 player_ids 映射，playerIdsDrops 为当时的丢帧数
+        bool playerIds = false;
+        bool playerIdsSynced = false;
+        uint64_t playerIdsDrops = 0;
+    };
+
+    // 同一条广播某种编码在不同压缩参数下的帧，按需构造并在相同参数的客户端之间共享
+    struct EncodedFrames {
+        FrameRef plain;
+        FrameRef local; // 本机连接使用的长度前缀帧，负载与 plain 相同
+        FrameRef deflated[16];
+        bool deflateTried[16] = {};
+    };
+
+    struct FrameSet {
+        EncodedFrames json;
+        EncodedFrames msgpack;
+        // 紧凑编码，plain 为空表示与完整编码相同
+        EncodedFrames compactJson;
+        EncodedFrames compactMsgpack;
+        uint64_t seq = 0;
+        uint32_t topic = 0;
+        std::string player;
+    };
+
+    // 为一条消息构造各编码的未压缩帧
+    static FrameSet makeFrameSet(EncodedMessage&& message);
+
+    // 事件循环线程函数
+    void runLoop();
+
+    // 接受监听 socket 上所有待处理的新连接
+    void acceptPending(SocketHandle listener, bool local);
+
+    // 处理连接可读 / 可写事件
+    void onReadable(Session& session);
+    void onWritable(Session& session);
+
+    // 握手完成后注册连接的发送队列，并处理握手请求之后已到达的数据
+    void onHandshakeComplete(Session& session);
+
+    // 把收到的数据交给帧解析器，逐个处理解析出的帧
+    void processFrames(Session& session, const char* data, size_t length);
 
-    // 处理单个客户端连接
-    void handleClient(SOCKET clientSocket);
+    // 处理一个已解析完成的消息或控制帧
+    void handleFrame(Session& session);
 
-    // WebSocket 握手
-    bool performHandshake(SOCKET clientSocket);
+    // 处理 resume 请求: 停止向该连接广播，改为从 lastSeq 之后开始重放日志
+    void startReplay(Session& session, uint64_t lastSeq);
 
-    // 发送 WebSocket 帧
-    bool sendFrame(SOCKET clientSocket, const std::string& message);
+    // 处理 subscribe 请求，更新连接的订阅
+    void setSubscription(Session& session, std::shared_ptr<const Subscription> subscription);
 
-    // 接收 WebSocket 帧
-    std::string receiveFrame(SOCKET clientSocket);
+    // 处理 hello 请求中的 player_ids 特性: 之后改为发送紧凑编码，并立即发送当前映射
+    void enablePlayerIds(Session& session);
 
-    // 计算 WebSocket Accept Key
-    std::string computeAcceptKey(const std::string& clientKey);
+    // 紧凑编码的客户端尚未同步映射时先推入 player_ids 消息 (每次广播最多构造一次)，调用方需持有 mQueuesMutex
+    void syncPlayerIdsLocked(ClientEntry& client, std::optional<FrameSet>& mapping);
 
-    // Base64 编码
-    std::string base64Encode(const unsigned char* data, size_t length);
+    // 重新计算所有客户端订阅的事件类型，调用方需持有 mQueuesMutex
+    void updateSubscribedTopicsLocked();
 
-    // SHA1 哈希
-    void sha1(const std::string& input, unsigned char output[20]);
+    // 把日志中的下一批事件推入发送队列 (最多半个队列)，追上日志末尾后恢复接收广播
+    void pumpReplay(Session& session);
+
+    // 发送关闭帧，写完后关闭连接
+    void sendClose(Session& session, CloseCode code);
+
+    // 标记连接在写完剩余数据后关闭，并安排超时以免对方不读取
+    void closeAfterFlush(Session& session);
+
+    // 处理不带 WebSocket 升级的普通 HTTP GET 请求，返回 false 表示请求行无效
+    bool handleHttpRequest(Session& session, const std::string& request);
+
+    // 发送 HTTP 响应，写完后关闭连接
+    void sendHttpResponse(Session& session, const char* status, const char* contentType, const std::string& body);
+
+    // 生成 /metrics 的响应内容 (在事件循环线程中调用)
+    std::string renderMetrics() const;
+
+    // 推进时间轮，检查到期连接的心跳和超时
+    void processTimers();
+
+    // 检查单个连接: 握手超时、空闲超时、发送 ping / 等待 pong、慢消费者，并安排下一次检查
+    void checkSession(Session& session, TimerWheel::Clock::time_point now);
+
+    // 尚未写出的字节数 (正在写出的帧 + 发送队列)
+    size_t pendingBytes(const Session& session) const;
+
+    // 处理各客户端发送队列中新入队的帧和溢出断开请求
+    void flushQueues();
+
+    // 追加由事件循环线程直接发送的数据 (如握手响应) 并尝试立即写出
+    void queueSend(Session& session, FrameRef frame);
+
+    // 把帧推入所有客户端的发送队列，调用方需持有 mQueuesMutex
+    void enqueueLocked(FrameSet& frames, size_t& overflowed);
+
+    // 各广播入口入队后的收尾: 记录溢出的客户端数并唤醒事件循环，调用方需持有 mQueuesMutex
+    void finishEnqueueLocked(size_t overflowed);
+
+    // 客户端是否接收这条消息的紧凑编码
+    static bool usesCompact(const FrameSet& frameSet, const ClientEntry& client);
+
+    // 为客户端选择合适的帧 (支持 player_ids 时优先使用紧凑编码)，需要时压缩 (每种窗口大小只压缩一次)，调用方需持有 mQueuesMutex
+    // 返回 nullptr 表示消息没有该客户端使用的编码
+    const FrameRef* selectFrameLocked(FrameSet& frames, const ClientEntry& client);
+
+    // 通知事件循环有新数据入队，合并连续的唤醒请求
+    void requestWakeup();
+
+    // 更新连接在 poller 中的关注事件
+    void updateInterest(Session& session);
+
+    // 关闭并移除连接
+    void closeSession(uint64_t id);
+
+    // WebSocket 握手，返回 false 表示握手失败；数据不完整时 complete 为 false
+    bool performHandshake(Session& session, bool& complete);
+
+    // 本机连接的握手: 读取客户端发送的协议名，返回值语义同 performHandshake
+    bool performLocalHandshake(Session& session, bool& complete);
 
     std::string mHost;
     int mPort;
-    MclistenerWsServerMod* mMod;
-    
-    SOCKET mServerSocket = INVALID_SOCKET;
+    const Config& mConfig;
+    Logger& mLogger;
+
+    SocketHandle mServerSocket = InvalidSocket;
+    std::string mLocalSocketPath;
+    SocketHandle mLocalSocket = InvalidSocket;
+    RateLimit mInboundRateLimit; // 每个连接的入站消息限流 (clientMessageRateLimit)
     std::atomic<bool> mRunning{false};
-    std::thread mAcceptThread;
-    
-    std::mutex mClientsMutex;
-    std::set<SOCKET> mClients;
-    
+    std::thread mLoopThread;
+    Poller mPoller;
+
+    // 只由事件循环线程访问
+    std::unordered_map<uint64_t, std::unique_ptr<Session>> mSessions;
+    uint64_t mNextSessionId = 1;
+    std::atomic<size_t> mClientCount{0};
+    std::atomic<size_t> mMsgPackClientCount{0};
+    std::atomic<size_t> mPlayerIdClientCount{0};
+    PlayerIdTable mPlayerIds;
+    // 所有客户端订阅的事件类型的并集
+    std::atomic<uint32_t> mSubscribedTopics{0};
+
+    // 已完成握手的客户端发送队列，供 broadcast() 在任意线程入队
+    std::mutex mQueuesMutex;
+    std::unordered_map<uint64_t, ClientEntry> mQueues;
+    size_t mQueueCapacity = 256;
+    OverflowPolicy mOverflowPolicy = OverflowPolicy::DropOldest;
+    std::atomic<bool> mWakeupPending{false};
+
+    // permessage-deflate 配置和按窗口大小缓存的压缩器 (由 mQueuesMutex 保护)
+    bool mDeflateEnabled = false;
+    bool mDeflateClientNoContextTakeover = true;
+    size_t mDeflateMinPayloadSize = 0;
+
+    // 是否接受 MessagePack 子协议
+    bool mMsgPackEnabled = false;
+    std::unique_ptr<DeflateCompressor> mCompressors[16];
+
+    // 心跳和超时配置 (0 表示关闭)，以及驱动它们的时间轮 (只由事件循环线程访问)
+    std::chrono::milliseconds mHandshakeTimeout{0};
+    std::chrono::milliseconds mIdleTimeout{0};
+    std::chrono::milliseconds mPingInterval{0};
+    std::chrono::milliseconds mPongTimeout{0};
+    std::chrono::milliseconds mSlowConsumerTimeout{0};
+    size_t mSlowConsumerQueueThreshold = 0;
+    size_t mSlowConsumerMaxBytes = 0;
+    TimerWheel mTimers;
+
+    // 是否响应 /metrics 和 /healthz，以及 /metrics 是否响应非本机的请求
+    bool mMetricsEnabled = false;
+    bool mMetricsAllowRemote = false;
+    Metrics mMetrics;
+
     MessageCallback mMessageCallback;
+    EventJournal* mJournal = nullptr;
 };
 
 } // namespace mclistener_ws_server
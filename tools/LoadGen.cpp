@@ -0,0 +1,406 @@
+// 压测工具
+// 在本地端口启动 WebSocketServer，建立 N 个 WebSocket 客户端连接，
+// 以指定速率广播带发送时间戳的消息，统计端到端广播延迟分位数、吞吐量和丢失条数
+//
+// 用法: mclistener-ws-loadgen [--clients N] [--messages M] [--rate R] [--payload BYTES]
+//                             [--port PORT] [--queue CAPACITY] [--policy drop_oldest|drop_newest|disconnect]
+//                             [--local SOCKET_PATH]
+// --rate 0 表示不限速；--local 时客户端改为通过该 Unix 域 socket 使用本机传输连接
+
+#include "mod/Config.h"
+#include "mod/Frame.h"
+#include "mod/Log.h"
+#include "mod/Poller.h"
+#include "mod/Socket.h"
+#include "mod/WebSocketServer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace mclistener_ws_server;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// 输出到 stderr 的 logger
+class StderrLogger : public Logger {
+protected:
+    void write(LogLevel level, const std::string& text) override {
+        static const char* names[] = {"FATAL", "ERROR", "WARN", "INFO", "DEBUG", "TRACE"};
+        std::fprintf(stderr, "[%s] %s\n", names[static_cast<int>(level)], text.c_str());
+    }
+};
+
+struct Options {
+    int         clients  = 100;
+    int         messages = 10000;
+    int         rate     = 1000; // 每秒广播条数，0 表示不限速
+    int         payload  = 128;  // 每条消息的填充字节数
+    int         port     = 18080;
+    int         queue    = 256;
+    std::string policy   = "drop_oldest";
+    std::string local;            // 非空时使用本机传输
+};
+
+// 一个模拟客户端: 收到的字节缓存在 buffer 中，按帧切分
+struct Client {
+    SocketHandle      socket = InvalidSocket;
+    std::string       buffer;       // 尚未切分成帧的数据
+    uint64_t          received = 0; // 收到的广播条数
+    uint64_t          bytes    = 0; // 收到的广播负载字节数
+    bool              closed   = false;
+};
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "missing value for %s\n", arg.c_str());
+            return false;
+        }
+        const char* value = argv[++i];
+        if (arg == "--clients") {
+            options.clients = std::atoi(value);
+        } else if (arg == "--messages") {
+            options.messages = std::atoi(value);
+        } else if (arg == "--rate") {
+            options.rate = std::atoi(value);
+        } else if (arg == "--payload") {
+            options.payload = std::atoi(value);
+        } else if (arg == "--port") {
+            options.port = std::atoi(value);
+        } else if (arg == "--queue") {
+            options.queue = std::atoi(value);
+        } else if (arg == "--policy") {
+            options.policy = value;
+        } else if (arg == "--local") {
+            options.local = value;
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return options.clients > 0 && options.messages > 0 && options.rate >= 0 && options.payload >= 0;
+}
+
+// 阻塞发送全部数据 (仅用于握手)
+bool sendAll(SocketHandle socket, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int64_t n = sendSome(socket, data.data() + sent, data.size() - sent);
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// 建立本机传输连接，发送协议名后即可接收广播
+bool connectLocalClient(const std::string& path, Client& client) {
+    client.socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (client.socket == InvalidSocket) {
+        return false;
+    }
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (::connect(client.socket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        return false;
+    }
+    return sendAll(client.socket, std::string(WebSocketServer::JsonLocalProtocol) + "\n")
+        && setNonBlocking(client.socket);
+}
+
+// 建立连接并完成 WebSocket 握手，握手响应之后多读到的字节留在 client.buffer 中
+bool connectClient(int port, Client& client) {
+    client.socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (client.socket == InvalidSocket) {
+        return false;
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(static_cast<uint16_t>(port));
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (::connect(client.socket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        return false;
+    }
+    setNoDelay(client.socket, true);
+
+    std::string request = "GET / HTTP/1.1\r\n"
+                          "Host: 127.0.0.1:" + std::to_string(port) + "\r\n"
+                          "Upgrade: websocket\r\n"
+                          "Connection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                          "Sec-WebSocket-Version: 13\r\n"
+                          "\r\n";
+    if (!sendAll(client.socket, request)) {
+        return false;
+    }
+
+    char buf[4096];
+    while (client.buffer.find("\r\n\r\n") == std::string::npos) {
+        int64_t n = recvSome(client.socket, buf, sizeof(buf));
+        if (n <= 0) {
+            return false;
+        }
+        client.buffer.append(buf, static_cast<size_t>(n));
+    }
+    if (client.buffer.compare(0, 12, "HTTP/1.1 101") != 0) {
+        return false;
+    }
+    client.buffer.erase(0, client.buffer.find("\r\n\r\n") + 4);
+    return setNonBlocking(client.socket);
+}
+
+// 构造带掩码的客户端帧 (掩码键为 0，负载不变)
+std::string encodeClientFrame(unsigned char opcode, const std::string& payload) {
+    std::string frame;
+    frame.push_back(static_cast<char>(0x80 | opcode));
+    frame.push_back(static_cast<char>(0x80 | payload.size())); // 控制帧负载不超过 125 字节
+    frame.append(4, '\0');
+    frame += payload;
+    return frame;
+}
+
+// 从消息中取出发送时间戳
+int64_t parseSentAt(const char* data, size_t length) {
+    static const char key[] = "\"sent_ns\":";
+    std::string_view view(data, length);
+    size_t pos = view.find(key);
+    if (pos == std::string_view::npos) {
+        return -1;
+    }
+    return std::strtoll(data + pos + sizeof(key) - 1, nullptr, 10);
+}
+
+// 记录一个完整的帧
+void handleFrame(Client& client, unsigned char opcode, const char* payload, uint64_t length, int64_t nowNs,
+                 std::vector<int64_t>& latencies) {
+    if (opcode == 0x1) {
+        int64_t sentAt = parseSentAt(payload, static_cast<size_t>(length));
+        if (sentAt >= 0) {
+            latencies.push_back(nowNs - sentAt);
+            ++client.received;
+            client.bytes += length;
+        }
+    } else if (opcode == 0x9) {
+        sendAll(client.socket, encodeClientFrame(0xA, std::string(payload, static_cast<size_t>(length))));
+    } else if (opcode == 0x8) {
+        client.closed = true;
+    }
+}
+
+// 切分并处理本机传输的长度前缀帧 (本机连接不会收到 ping)
+void processLocalFrames(Client& client, int64_t nowNs, std::vector<int64_t>& latencies) {
+    size_t offset = 0;
+    const auto* data = reinterpret_cast<const unsigned char*>(client.buffer.data());
+    while (client.buffer.size() - offset >= LengthPrefixedHeaderSize) {
+        uint64_t length = (uint64_t{data[offset]} << 24) | (uint64_t{data[offset + 1]} << 16)
+                        | (uint64_t{data[offset + 2]} << 8) | data[offset + 3];
+        if (client.buffer.size() - offset - LengthPrefixedHeaderSize < length) {
+            break;
+        }
+        handleFrame(client, data[offset + 4], client.buffer.data() + offset + LengthPrefixedHeaderSize, length, nowNs,
+                    latencies);
+        offset += LengthPrefixedHeaderSize + static_cast<size_t>(length);
+    }
+    client.buffer.erase(0, offset);
+}
+
+// 切分并处理 client.buffer 中的完整帧，文本帧的延迟写入 latencies
+void processFrames(Client& client, int64_t nowNs, std::vector<int64_t>& latencies) {
+    size_t offset = 0;
+    const auto* data = reinterpret_cast<const unsigned char*>(client.buffer.data());
+    while (client.buffer.size() - offset >= 2) {
+        unsigned char opcode = data[offset] & 0x0F;
+        uint64_t length = data[offset + 1] & 0x7F;
+        size_t header = 2;
+        if (length == 126) {
+            header = 4;
+        } else if (length == 127) {
+            header = 10;
+        }
+        if (client.buffer.size() - offset < header) {
+            break;
+        }
+        if (header == 4) {
+            length = (uint64_t{data[offset + 2]} << 8) | data[offset + 3];
+        } else if (header == 10) {
+            length = 0;
+            for (size_t i = 0; i < 8; ++i) {
+                length = (length << 8) | data[offset + 2 + i];
+            }
+        }
+        if (client.buffer.size() - offset - header < length) {
+            break;
+        }
+
+        handleFrame(client, opcode, client.buffer.data() + offset + header, length, nowNs, latencies);
+        offset += header + static_cast<size_t>(length);
+    }
+    client.buffer.erase(0, offset);
+}
+
+int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+double percentile(const std::vector<int64_t>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return static_cast<double>(sorted[std::min(index, sorted.size() - 1)]) / 1000.0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr,
+                     "usage: %s [--clients N] [--messages M] [--rate R] [--payload BYTES] [--port PORT] "
+                     "[--queue CAPACITY] [--policy drop_oldest|drop_newest|disconnect] [--local SOCKET_PATH]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    setActiveLogLevel(LogLevel::Warn);
+    StderrLogger logger;
+
+    Config config;
+    config.sendQueueCapacity       = options.queue;
+    config.sendQueueOverflowPolicy = options.policy;
+    config.enableMetricsEndpoint   = false;
+
+    WebSocketServer server("127.0.0.1", options.port, config, logger);
+    server.setLocalSocketPath(options.local);
+    if (!server.start()) {
+        std::fprintf(stderr, "failed to start server on port %d\n", options.port);
+        return 1;
+    }
+
+    int error = 0;
+    if (!socketStartup(error)) {
+        std::fprintf(stderr, "socket startup failed: %d\n", error);
+        return 1;
+    }
+
+    std::vector<Client> clients(static_cast<size_t>(options.clients));
+    Poller poller;
+    if (!poller.open()) {
+        std::fprintf(stderr, "failed to open poller\n");
+        return 1;
+    }
+    for (size_t i = 0; i < clients.size(); ++i) {
+        bool connected = options.local.empty() ? connectClient(options.port, clients[i])
+                                               : connectLocalClient(options.local, clients[i]);
+        if (!connected) {
+            std::fprintf(stderr, "client %zu failed to connect\n", i);
+            return 1;
+        }
+        poller.add(clients[i].socket, i, Poller::Readable);
+    }
+
+    // 等待服务器完成所有握手
+    auto deadline = Clock::now() + std::chrono::seconds(10);
+    while (server.getClientCount() < clients.size() && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::printf("connected %zu/%zu clients\n", server.getClientCount(), clients.size());
+
+    // 广播线程: 按速率发送带时间戳的消息
+    std::atomic<bool> sendDone{false};
+    const std::string padding(static_cast<size_t>(options.payload), 'x');
+    auto sendStart = Clock::now();
+    std::thread sender([&] {
+        for (int seq = 0; seq < options.messages; ++seq) {
+            if (options.rate > 0) {
+                std::this_thread::sleep_until(sendStart + std::chrono::nanoseconds(int64_t{1000000000} * seq / options.rate));
+            }
+            EncodedMessage message;
+            message.json = "{\"seq\":" + std::to_string(seq) + ",\"sent_ns\":" + std::to_string(nowNanos())
+                         + ",\"pad\":\"" + padding + "\"}";
+            server.broadcast(std::move(message));
+        }
+        sendDone = true;
+    });
+
+    // 接收: 全部送达，或发送结束后 2 秒内没有新数据时结束
+    const uint64_t expected = static_cast<uint64_t>(options.messages) * clients.size();
+    std::vector<int64_t> latencies;
+    latencies.reserve(expected);
+    std::vector<Poller::Event> events;
+    char buf[65536];
+    auto lastProgress = Clock::now();
+    while (latencies.size() < expected) {
+        if (sendDone && Clock::now() - lastProgress > std::chrono::seconds(2)) {
+            break;
+        }
+        if (poller.wait(events, 100) <= 0) {
+            continue;
+        }
+        for (const auto& event : events) {
+            Client& client = clients[event.token];
+            while (true) {
+                int64_t n = recvSome(client.socket, buf, sizeof(buf));
+                if (n > 0) {
+                    client.buffer.append(buf, static_cast<size_t>(n));
+                    continue;
+                }
+                if (n == 0 || !isWouldBlock(lastSocketError())) {
+                    client.closed = true;
+                    poller.remove(client.socket);
+                }
+                break;
+            }
+            if (options.local.empty()) {
+                processFrames(client, nowNanos(), latencies);
+            } else {
+                processLocalFrames(client, nowNanos(), latencies);
+            }
+            lastProgress = Clock::now();
+        }
+    }
+    auto recvEnd = Clock::now();
+    sender.join();
+
+    size_t disconnected = 0;
+    uint64_t receivedBytes = 0;
+    for (auto& client : clients) {
+        disconnected += client.closed ? 1 : 0;
+        receivedBytes += client.bytes;
+        closeSocket(client.socket);
+    }
+    poller.close();
+    server.stop();
+    socketCleanup();
+
+    std::sort(latencies.begin(), latencies.end());
+    double seconds = std::chrono::duration<double>(recvEnd - sendStart).count();
+    std::printf("clients %d (%s), messages %d, rate %s, payload %d bytes, queue %d (%s)\n", options.clients,
+                options.local.empty() ? "websocket" : "local", options.messages,
+                options.rate > 0 ? std::to_string(options.rate).c_str() : "unlimited", options.payload, options.queue,
+                options.policy.c_str());
+    std::printf("delivered %zu/%llu (lost %llu), disconnected clients %zu\n", latencies.size(),
+                static_cast<unsigned long long>(expected), static_cast<unsigned long long>(expected - latencies.size()),
+                disconnected);
+    std::printf("elapsed %.3f s, throughput %.0f msg/s (%.1f MB/s)\n", seconds,
+                static_cast<double>(latencies.size()) / seconds,
+                static_cast<double>(receivedBytes) / seconds / 1e6);
+    std::printf("latency us: p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n", percentile(latencies, 0.50),
+                percentile(latencies, 0.90), percentile(latencies, 0.99), percentile(latencies, 0.999),
+                percentile(latencies, 1.0));
+    return 0;
+}
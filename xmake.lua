@@ -5,13 +5,20 @@ add_repositories("levimc-repo https://github.com/LiteLDev/xmake-repo.git")
 -- add_requires("levilamina x.x.x") for a specific version
 -- add_requires("levilamina develop") to use develop version
 -- please note that you should add bdslibrary yourself if using dev version
-if is_config("target_type", "server") then
-    add_requires("levilamina", {configs = {target_type = "server"}})
-else
-    add_requires("levilamina", {configs = {target_type = "client"}})
+if is_plat("windows") then
+    if is_config("target_type", "server") then
+        add_requires("levilamina", {configs = {target_type = "server"}})
+    else
+        add_requires("levilamina", {configs = {target_type = "client"}})
+    end
+
+    add_requires("levibuildscript")
+    add_requires("zlib")
 end
 
-add_requires("levibuildscript")
+if has_config("bench") then
+    add_requires("benchmark", "fmt", "nlohmann_json", "zlib")
+end
 
 if not has_config("vs_runtime") then
     set_runtimes("MD")
@@ -23,12 +30,18 @@ option("target_type")
     set_values("server", "client")
 option_end()
 
+option("bench") -- 构建主机端微基准测试: xmake f --bench=y
+    set_default(false)
+    set_showmenu(true)
+option_end()
+
+if is_plat("windows") then
 target("mclistener-ws-server") -- 插件名称
     add_rules("@levibuildscript/linkrule")
     add_rules("@levibuildscript/modpacker")
     add_cxflags( "/EHa", "/utf-8", "/W4", "/w44265", "/w44289", "/w44296", "/w45263", "/w44738", "/w45204")
     add_defines("NOMINMAX", "UNICODE")
-    add_packages("levilamina")
+    add_packages("levilamina", "zlib")
     set_exceptions("none") -- To avoid conflicts with /EHa.
     set_kind("shared")
     set_languages("c++20")
@@ -41,3 +54,40 @@ target("mclistener-ws-server") -- 插件名称
     else
         add_defines("LL_PLAT_C")
     end
+end
+
+-- 不依赖 LeviLamina 的核心代码 (帧编解码、握手、事件循环、广播扇出)，
+-- 插件直接编译这些源文件，基准测试和压测工具链接这个静态库
+local core_files = {"src/mod/*.cpp|MclistenerWsServerMod.cpp|MemoryOperators.cpp"}
+
+if has_config("bench") then
+target("mclistener-ws-core")
+    set_kind("static")
+    set_default(false)
+    set_languages("c++20")
+    add_packages("fmt", "nlohmann_json", "zlib", {public = true})
+    add_includedirs("src", {public = true})
+    add_files(core_files)
+    if is_plat("windows") then
+        add_cxflags("/utf-8", {public = true})
+        add_defines("NOMINMAX", {public = true})
+        add_syslinks("ws2_32")
+    else
+        add_syslinks("pthread")
+    end
+
+target("mclistener-ws-bench") -- 微基准测试，不依赖 LeviLamina，可在 Linux 上运行
+    set_kind("binary")
+    set_default(false)
+    set_languages("c++20")
+    add_deps("mclistener-ws-core")
+    add_packages("benchmark")
+    add_files("bench/*.cpp")
+
+target("mclistener-ws-loadgen") -- 压测工具: 本地启动服务器并用 N 个客户端测量广播延迟
+    set_kind("binary")
+    set_default(false)
+    set_languages("c++20")
+    add_deps("mclistener-ws-core")
+    add_files("tools/LoadGen.cpp")
+end